@@ -0,0 +1,102 @@
+// Measures spawning and despawning objects in a Handle_pool against one heap
+// allocation per object in a vector of pointers, as GLApp used to store them.
+// Usage: handle_pool_bench.bench [live_objects] [frames]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "HandlePool.h"
+#include "Object.h"
+
+namespace {
+  using Clock = std::chrono::steady_clock;
+
+  // Objects replaced each frame, as a share of the live ones
+  constexpr size_t CHURN = 10;
+
+  double milliseconds(Clock::time_point start)
+  {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start)
+      .count();
+  }
+
+  // Sum a value of every object so iteration cannot be skipped
+  template <typename Range, typename Get>
+  float visit(const Range &objects, Get get)
+  {
+    float sum = 0.0f;
+    for (const auto &obj : objects) {
+      sum += get(obj).instance().model[3][0];
+    }
+    return sum;
+  }
+}  // namespace
+
+int main(int argc, char **argv)
+{
+  size_t live = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 50000;
+  size_t frames = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 100;
+  size_t churn = std::max<size_t>(1, live / CHURN);
+  auto mesh = std::make_shared<Mesh>();
+  std::mt19937 rng(42);
+  float sum = 0.0f;
+
+  // One new and delete per object
+  {
+    std::vector<Object *> objects;
+    for (size_t i = 0; i < live; ++i) {
+      objects.push_back(new Object(mesh));
+    }
+    auto start = Clock::now();
+    for (size_t frame = 0; frame < frames; ++frame) {
+      for (size_t i = 0; i < churn; ++i) {
+        size_t victim = rng() % objects.size();
+        delete objects[victim];
+        objects[victim] = objects.back();
+        objects.pop_back();
+      }
+      for (size_t i = 0; i < churn; ++i) {
+        objects.push_back(new Object(mesh));
+      }
+      sum += visit(objects, [](const Object *obj) -> const Object & {
+        return *obj;
+      });
+    }
+    std::cout << "pointers  " << milliseconds(start) / frames
+              << " ms per frame\n";
+    for (Object *obj : objects) {
+      delete obj;
+    }
+  }
+
+  // Generational handles into contiguous storage
+  {
+    Handle_pool<Object> objects(live);
+    for (size_t i = 0; i < live; ++i) {
+      objects.create(mesh);
+    }
+    auto start = Clock::now();
+    for (size_t frame = 0; frame < frames; ++frame) {
+      for (size_t i = 0; i < churn; ++i) {
+        objects.destroy(objects.handle(rng() % objects.size()));
+      }
+      for (size_t i = 0; i < churn; ++i) {
+        objects.create(mesh);
+      }
+      sum += visit(objects, [](const Object &obj) -> const Object & {
+        return obj;
+      });
+    }
+    std::cout << "pool      " << milliseconds(start) / frames
+              << " ms per frame\n";
+  }
+
+  std::cout << live << " objects, " << churn << " replaced per frame ("
+            << sum << ")\n";
+  return EXIT_SUCCESS;
+}
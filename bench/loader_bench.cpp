@@ -0,0 +1,273 @@
+// Baseline for Obj_spec: generates synthetic .conf meshes and times each
+// loading stage, printing JSON. Every size is loaded in a child process so
+// its peak RSS is measured on its own.
+// Usage: loader_bench.bench [--max triangles] [--out file.json] [--optimize]
+//        [--quantize] [--lods]
+
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+#include "Object.h"
+
+namespace {
+  using Clock = std::chrono::steady_clock;
+
+  std::atomic<size_t> allocations = 0;
+  std::atomic<size_t> allocated_bytes = 0;
+
+  // Grid of quads close to the requested triangle count, written with
+  // to_chars in large blocks so generation stays cheap next to parsing
+  size_t write_conf(const std::string &path, size_t triangles)
+  {
+    size_t side = 1;
+    while (2 * (side + 1) * (side + 1) <= triangles) {
+      ++side;
+    }
+    size_t rows = triangles / 2 / side + 1;
+
+    std::ofstream outfile(path, std::ios::binary | std::ios::trunc);
+    std::string buffer;
+    auto flush = [&](bool force) {
+      if (force || buffer.size() > (1 << 20)) {
+        outfile.write(buffer.data(), buffer.size());
+        buffer.clear();
+      }
+    };
+    auto put = [&](auto value) {
+      char text[32];
+      auto [end, err] = std::to_chars(text, text + sizeof(text), value);
+      buffer.append(text, end);
+    };
+
+    size_t vertex_count = (side + 1) * (rows + 1);
+    buffer += "# Synthetic grid\ncolour 0.8 0.4 0.2\nverts ";
+    put(vertex_count);
+    buffer += '\n';
+    for (size_t y = 0; y <= rows; ++y) {
+      for (size_t x = 0; x <= side; ++x) {
+        put(0.01f * x);
+        buffer += ' ';
+        put(0.001f * ((x * 7 + y * 13) % 17));
+        buffer += ' ';
+        put(0.01f * y);
+        buffer += '\n';
+        flush(false);
+      }
+    }
+
+    buffer += "indices ";
+    put(triangles);
+    buffer += '\n';
+    for (size_t t = 0; t < triangles; ++t) {
+      size_t quad = t / 2;
+      size_t a = (quad / side) * (side + 1) + quad % side;
+      size_t b = a + 1;
+      size_t c = a + side + 1;
+      size_t corners[2][3] = {{a, c, b}, {b, c, c + 1}};
+      for (int k = 0; k < 3; ++k) {
+        put(corners[t % 2][k]);
+        buffer += k < 2 ? ' ' : '\n';
+      }
+      flush(false);
+    }
+    flush(true);
+
+    return vertex_count;
+  }
+
+  // Load one file and describe the run as a JSON object
+  std::string measure(
+    const std::string &path,
+    size_t triangles,
+    size_t vertex_count,
+    const Load_options &options
+  )
+  {
+    size_t bytes = std::filesystem::file_size(path);
+    allocations = 0;
+    allocated_bytes = 0;
+
+    std::cout.setstate(std::ios::failbit);
+    auto start = Clock::now();
+    Object::Obj_spec spec(path, options);
+    std::chrono::duration<double> total = Clock::now() - start;
+    size_t count = allocations;
+    size_t count_bytes = allocated_bytes;
+    std::cout.clear();
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    const auto &t = spec.timings;
+    double mb = bytes / (1024.0 * 1024.0);
+    std::ostringstream json;
+    json << "{\"triangles\": " << triangles
+         << ", \"vertices\": " << vertex_count << ", \"file_bytes\": " << bytes
+         << ", \"parse_s\": " << t.parse << ", \"validate_s\": " << t.validate
+         << ", \"prepare_s\": " << t.prepare << ", \"cache_write_s\": "
+         << t.cache << ", \"pack_s\": " << t.pack
+         << ", \"total_s\": " << total.count()
+         << ", \"parse_mb_per_s\": " << mb / t.parse
+         << ", \"triangles_per_s\": " << triangles / total.count()
+         << ", \"peak_rss_kb\": " << usage.ru_maxrss
+         << ", \"allocations\": " << count
+         << ", \"allocated_bytes\": " << count_bytes << "}";
+    return json.str();
+  }
+
+  // Run a measurement in a child process and read back its JSON
+  std::string measure_isolated(
+    const std::string &path,
+    size_t triangles,
+    size_t vertex_count,
+    const Load_options &options
+  )
+  {
+    int fds[2];
+    if (pipe(fds) != 0) {
+      throw std::runtime_error("Cannot create pipe");
+    }
+
+    pid_t pid = fork();
+    if (pid < 0) {
+      throw std::runtime_error("Cannot fork benchmark run");
+    }
+    if (pid == 0) {
+      close(fds[0]);
+      std::string json;
+      try {
+        json = measure(path, triangles, vertex_count, options);
+      } catch (const std::exception &err) {
+        std::cerr << err.what() << '\n';
+        _exit(EXIT_FAILURE);
+      }
+      ssize_t written = write(fds[1], json.data(), json.size());
+      _exit(written == ssize_t(json.size()) ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
+    close(fds[1]);
+    std::string json;
+    char chunk[4096];
+    ssize_t count;
+    while ((count = read(fds[0], chunk, sizeof(chunk))) > 0) {
+      json.append(chunk, count);
+    }
+    close(fds[0]);
+
+    int status;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+      throw std::runtime_error("Benchmark run failed for " + path);
+    }
+    return json;
+  }
+}  // namespace
+
+// Count every heap allocation made by the loader
+void *operator new(size_t size)
+{
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+  if (void *ptr = std::malloc(size ? size : 1)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept
+{
+  std::free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+  std::free(ptr);
+}
+
+int main(int argc, char **argv)
+{
+  size_t max_triangles = 50000000;
+  std::string out_path;
+  Load_options options;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--max" && i + 1 < argc) {
+      max_triangles = std::strtoull(argv[++i], nullptr, 10);
+    }
+    else if (arg == "--out" && i + 1 < argc) {
+      out_path = argv[++i];
+    }
+    else if (arg == "--optimize") {
+      options.optimize = true;
+    }
+    else if (arg == "--quantize") {
+      options.quantize = true;
+    }
+    else if (arg == "--lods") {
+      options.lod_ratios = {0.5f, 0.25f, 0.125f};
+    }
+    else {
+      std::cerr << "Unknown argument: " << arg << '\n';
+      return EXIT_FAILURE;
+    }
+  }
+
+  std::string dir =
+    (std::filesystem::temp_directory_path() / "loader_bench").string();
+  std::filesystem::create_directories(dir);
+
+  std::ostringstream json;
+  json << std::boolalpha << "{\"benchmark\": \"loader\", \"optimize\": "
+       << options.optimize
+       << ", \"quantize\": " << options.quantize
+       << ", \"lods\": " << options.lod_ratios.size() << ", \"runs\": [";
+  bool first = true;
+  for (size_t triangles :
+       {1000, 10000, 100000, 1000000, 10000000, 50000000}) {
+    if (triangles > max_triangles) {
+      break;
+    }
+
+    std::string path = dir + "/grid_" + std::to_string(triangles) + ".conf";
+    size_t vertex_count = write_conf(path, triangles);
+    try {
+      std::string run =
+        measure_isolated(path, triangles, vertex_count, options);
+      json << (first ? "\n  " : ",\n  ") << run;
+      first = false;
+      std::cerr << "Measured " << triangles << " triangles\n";
+    } catch (const std::exception &err) {
+      std::cerr << err.what() << '\n';
+    }
+
+    // Drop the source and its cache
+    for (const auto &entry : std::filesystem::directory_iterator(dir)) {
+      std::filesystem::remove(entry.path());
+    }
+  }
+  json << "\n]}\n";
+
+  if (out_path.empty()) {
+    std::cout << json.str();
+  }
+  else {
+    std::ofstream(out_path) << json.str();
+  }
+
+  std::filesystem::remove_all(dir);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,90 @@
+// Measures what Mesh_optimizer saves on a large grid whose triangles arrive
+// in random order, as they do from many exporters.
+// Usage: mesh_opt_bench.bench [grid_size]
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "MeshOptimizer.h"
+
+namespace {
+  // Height field of size x size quads, triangles shuffled
+  void make_grid(
+    size_t size,
+    std::vector<float> &vertices,
+    std::vector<unsigned int> &indices
+  )
+  {
+    for (size_t y = 0; y <= size; ++y) {
+      for (size_t x = 0; x <= size; ++x) {
+        float height = 0.1f * static_cast<float>((x * 7 + y * 13) % 5);
+        vertices.insert(vertices.end(), {float(x), height, float(y)});
+      }
+    }
+
+    std::vector<std::array<unsigned int, 3>> triangles;
+    for (size_t y = 0; y < size; ++y) {
+      for (size_t x = 0; x < size; ++x) {
+        unsigned int a = y * (size + 1) + x;
+        unsigned int b = a + 1;
+        unsigned int c = a + size + 1;
+        unsigned int d = c + 1;
+        triangles.push_back({a, c, b});
+        triangles.push_back({b, c, d});
+      }
+    }
+    std::shuffle(triangles.begin(), triangles.end(), std::mt19937(42));
+    for (const auto &triangle : triangles) {
+      indices.insert(indices.end(), triangle.begin(), triangle.end());
+    }
+  }
+
+  void report(const char *stage, std::span<const unsigned int> indices)
+  {
+    auto max = std::max_element(indices.begin(), indices.end());
+    auto stats = Mesh_optimizer::analyze(indices, *max + 1);
+    std::cout << stage << "ACMR " << stats.acmr << ", ATVR " << stats.atvr
+              << '\n';
+  }
+}  // namespace
+
+int main(int argc, char **argv)
+{
+  size_t size = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000;
+  std::vector<float> vertices;
+  std::vector<unsigned int> indices;
+  make_grid(size, vertices, indices);
+  std::cout << "grid      " << indices.size() / 3 << " triangles\n";
+  report("shuffled  ", indices);
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<size_t> clusters;
+  std::vector<unsigned int> cache_order = Mesh_optimizer::optimize_vertex_cache(
+    indices, vertices.size() / 3, clusters
+  );
+  std::chrono::duration<double, std::milli> elapsed =
+    std::chrono::steady_clock::now() - start;
+  report("tipsify   ", cache_order);
+  std::cout << "          " << elapsed.count() << " ms, " << clusters.size()
+            << " clusters\n";
+
+  start = std::chrono::steady_clock::now();
+  std::vector<unsigned int> overdraw_order =
+    Mesh_optimizer::optimize_overdraw(cache_order, vertices, clusters);
+  elapsed = std::chrono::steady_clock::now() - start;
+  report("overdraw  ", overdraw_order);
+  std::cout << "          " << elapsed.count() << " ms\n";
+
+  start = std::chrono::steady_clock::now();
+  Mesh_optimizer::optimize_vertex_fetch(vertices, overdraw_order);
+  elapsed = std::chrono::steady_clock::now() - start;
+  report("fetch     ", overdraw_order);
+  std::cout << "          " << elapsed.count() << " ms\n";
+
+  return EXIT_SUCCESS;
+}
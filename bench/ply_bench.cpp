@@ -0,0 +1,98 @@
+// Compares Ply_importer throughput against reading the same file raw.
+// Usage: ply_bench.bench [vertex_count]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "PlyImporter.h"
+
+namespace {
+  using Clock = std::chrono::steady_clock;
+
+  // Write a random triangle soup in the layout scanners produce
+  void write_ply(const std::string &path, size_t vertex_count)
+  {
+    size_t face_count = 2 * vertex_count;
+    std::ofstream outfile(path, std::ios::binary);
+    outfile << "ply\nformat binary_little_endian 1.0\n"
+            << "element vertex " << vertex_count << "\n"
+            << "property float x\nproperty float y\nproperty float z\n"
+            << "element face " << face_count << "\n"
+            << "property list uchar int vertex_indices\nend_header\n";
+
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> coord(-1.0f, 1.0f);
+    std::uniform_int_distribution<int32_t> index(0, vertex_count - 1);
+
+    std::vector<float> vertices(3 * vertex_count);
+    std::generate(vertices.begin(), vertices.end(), [&] { return coord(rng); });
+    outfile.write(
+      reinterpret_cast<const char *>(vertices.data()),
+      vertices.size() * sizeof(float)
+    );
+
+    std::vector<char> faces(13 * face_count);
+    for (size_t i = 0; i < face_count; ++i) {
+      faces[13 * i] = 3;
+      for (int k = 0; k < 3; ++k) {
+        int32_t value = index(rng);
+        std::copy_n(
+          reinterpret_cast<const char *>(&value), 4, &faces[13 * i + 1 + 4 * k]
+        );
+      }
+    }
+    outfile.write(faces.data(), faces.size());
+  }
+
+  // Best of a few runs, in MB/s
+  template <typename Func>
+  double best_mbps(size_t bytes, Func func)
+  {
+    double best = 0;
+    for (int run = 0; run < 5; ++run) {
+      auto start = Clock::now();
+      func();
+      std::chrono::duration<double> elapsed = Clock::now() - start;
+      best = std::max(best, bytes / (1024.0 * 1024.0) / elapsed.count());
+    }
+    return best;
+  }
+}  // namespace
+
+int main(int argc, char **argv)
+{
+  size_t vertex_count =
+    argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 2000000;
+  std::string path =
+    (std::filesystem::temp_directory_path() / "ply_bench.ply").string();
+  write_ply(path, vertex_count);
+  size_t bytes = std::filesystem::file_size(path);
+
+  // Raw read of the file, from the page cache after the first run
+  std::vector<char> buffer(bytes);
+  double raw = best_mbps(bytes, [&] {
+    std::ifstream infile(path, std::ios::binary);
+    infile.read(buffer.data(), bytes);
+  });
+
+  // Full import into vertex and index arrays
+  std::cout.setstate(std::ios::failbit);
+  double ply = best_mbps(bytes, [&] { Ply_importer importer(path); });
+  std::cout.clear();
+
+  std::cout << "file      " << bytes << " bytes\n"
+            << "raw read  " << raw << " MB/s\n"
+            << "ply parse " << ply << " MB/s\n"
+            << "ratio     " << raw / ply << "x\n";
+
+  std::filesystem::remove(path);
+  return EXIT_SUCCESS;
+}
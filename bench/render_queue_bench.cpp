@@ -0,0 +1,139 @@
+// Measures ordering a frame's draws with the Render_queue radix sort against
+// std::sort with a comparison giving the same order, and counts the state
+// changes left by that order and by submission order.
+// Usage: render_queue_bench.bench [draws] [meshes] [frames]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <tuple>
+#include <vector>
+
+#include "RenderQueue.h"
+
+namespace {
+  using Clock = std::chrono::steady_clock;
+
+  // Shader variants in use, as feature bits
+  constexpr uint32_t PROGRAMS[] = {1, 3, 7};
+
+  // One in this many draws is transparent
+  constexpr size_t TRANSPARENT_SHARE = 10;
+
+  struct Draw {
+    uint32_t program;
+    uint32_t mesh;
+    size_t lod;
+    float depth;
+    bool transparent;
+  };
+
+  double milliseconds(Clock::time_point start)
+  {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start)
+      .count();
+  }
+
+  // Program and mesh switches when drawing in an order
+  size_t state_changes(const std::vector<Draw> &draws, const auto &order)
+  {
+    size_t changes = 0;
+    const Draw *last = nullptr;
+    for (size_t index : order) {
+      const Draw &draw = draws[index];
+      if (!last || last->program != draw.program) {
+        ++changes;
+      }
+      if (!last || last->mesh != draw.mesh) {
+        ++changes;
+      }
+      last = &draw;
+    }
+    return changes;
+  }
+}  // namespace
+
+int main(int argc, char **argv)
+{
+  size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100000;
+  uint32_t meshes = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 200;
+  size_t frames = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 100;
+
+  std::mt19937 rng(42);
+  std::uniform_real_distribution<float> depth(0.0f, 1.0f);
+  std::vector<Draw> draws(count);
+  for (Draw &draw : draws) {
+    draw = {
+      PROGRAMS[rng() % std::size(PROGRAMS)],
+      static_cast<uint32_t>(rng() % std::max<uint32_t>(meshes, 1)),
+      rng() % 4,
+      depth(rng),
+      rng() % TRANSPARENT_SHARE == 0
+    };
+  }
+
+  std::vector<size_t> order(count);
+  for (size_t i = 0; i < count; ++i) {
+    order[i] = i;
+  }
+  std::cout << "unsorted  " << state_changes(draws, order)
+            << " state changes\n";
+
+  // Opaque draws by state then front to back, transparent ones back to front
+  auto before = [&](size_t a, size_t b) {
+    const Draw &x = draws[a];
+    const Draw &y = draws[b];
+    if (x.transparent != y.transparent) {
+      return y.transparent;
+    }
+    if (x.transparent) {
+      return std::tuple(-x.depth, x.program, x.mesh, x.lod) <
+             std::tuple(-y.depth, y.program, y.mesh, y.lod);
+    }
+    return std::tuple(x.program, x.mesh, x.lod, x.depth) <
+           std::tuple(y.program, y.mesh, y.lod, y.depth);
+  };
+  auto start = Clock::now();
+  for (size_t frame = 0; frame < frames; ++frame) {
+    for (size_t i = 0; i < count; ++i) {
+      order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), before);
+  }
+  std::cout << "std::sort " << milliseconds(start) / frames
+            << " ms per frame, " << state_changes(draws, order)
+            << " state changes\n";
+
+  // Packed keys, radix sorted, including depth order within passes
+  Render_queue queue;
+  start = Clock::now();
+  for (size_t frame = 0; frame < frames; ++frame) {
+    queue.clear();
+    for (size_t i = 0; i < count; ++i) {
+      const Draw &draw = draws[i];
+      queue.push(
+        Render_queue::key(
+          draw.transparent ? Render_queue::TRANSPARENT : Render_queue::OPAQUE,
+          draw.program,
+          draw.mesh,
+          draw.lod,
+          draw.depth
+        ),
+        static_cast<uint32_t>(i)
+      );
+    }
+    queue.sort();
+  }
+  double elapsed = milliseconds(start) / frames;
+  std::vector<size_t> queued;
+  for (const Render_queue::Item &item : queue.items()) {
+    queued.push_back(item.payload);
+  }
+  std::cout << "queue     " << elapsed << " ms per frame, "
+            << state_changes(draws, queued) << " state changes\n";
+
+  std::cout << count << " draws of " << meshes << " meshes\n";
+  return EXIT_SUCCESS;
+}
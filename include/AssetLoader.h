@@ -0,0 +1,136 @@
+#ifndef ASSET_LOADER_H
+#define ASSET_LOADER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Object.h"
+
+/**
+ * Parses mesh files on a pool of worker threads and streams the results into
+ * GPU buffers from the GL thread, a bounded number of bytes per frame.
+ */
+class Asset_loader
+{
+  // File waiting to be parsed. Reloads carry the content hash the target
+  // was loaded from, so unchanged contents are not parsed again.
+  struct Job {
+    std::string filepath;
+    Load_options options;
+    std::weak_ptr<Mesh> target;
+    bool replace;
+    uint64_t source_hash;
+  };
+
+  // Parsed mesh waiting to be uploaded. Targets are not kept alive by the
+  // loader, meshes nobody uses any more are simply dropped. Reloads stream
+  // into a staging mesh that is swapped with the target once complete.
+  // Reloads of unchanged contents come back with neither a spec nor an
+  // error.
+  struct Upload {
+    std::weak_ptr<Mesh> target;
+    std::unique_ptr<Mesh> staging;
+    std::unique_ptr<Object::Obj_spec> spec;
+    std::string error;
+    size_t uploaded;
+    uint64_t source_hash;
+  };
+
+  std::vector<std::thread> _workers;
+  size_t _frame_budget;
+
+  // Parse queue shared with the workers
+  std::mutex _job_mutex;
+  std::condition_variable _job_cv;
+  std::deque<Job> _jobs;
+  bool _stopping;
+
+  // Parsed meshes handed back to the GL thread
+  std::mutex _parsed_mutex;
+  std::deque<Upload> _parsed;
+
+  // Uploads in progress, only touched by the GL thread
+  std::deque<Upload> _uploads;
+  size_t _pending;
+
+  /**
+   * @brief Hand a job to the workers
+   */
+  void queue(Job job);
+
+  /**
+   * @brief Worker thread body, parses files until the loader stops
+   */
+  void work();
+
+  /**
+   * @brief Upload part of a mesh
+   *
+   * @param upload Upload in progress
+   * @param target Mesh being uploaded
+   * @param budget Maximum number of bytes to upload
+   * @return Number of bytes uploaded
+   */
+  static size_t stream(Upload &upload, Mesh &target, size_t budget);
+
+public:
+  /**
+   * @brief Start the worker pool
+   *
+   * @param threads Number of parser threads, 0 picks one per core
+   * @param frame_budget Bytes uploaded to the GPU per call to pump()
+   */
+  Asset_loader(size_t threads = 0, size_t frame_budget = 4 << 20);
+  ~Asset_loader();
+
+  Asset_loader(const Asset_loader &) = delete;
+  Asset_loader &operator=(const Asset_loader &) = delete;
+
+  /**
+   * @brief Queue a mesh file to be loaded into an empty mesh
+   *
+   * @param filepath Path of the mesh file
+   * @param target Mesh that becomes drawable once its data is uploaded
+   * @param options Processing applied before upload
+   */
+  void load(
+    const std::string &filepath,
+    const std::shared_ptr<Mesh> &target,
+    const Load_options &options = {}
+  );
+
+  /**
+   * @brief Queue a mesh file to be loaded again into a mesh that may be in
+   * use. The mesh keeps drawing its current data until the new data is fully
+   * uploaded, and keeps it if the file fails to load or its contents are
+   * unchanged.
+   *
+   * @param filepath Path of the mesh file
+   * @param target Mesh to replace the contents of
+   * @param options Processing applied before upload
+   */
+  void reload(
+    const std::string &filepath,
+    const std::shared_ptr<Mesh> &target,
+    const Load_options &options = {}
+  );
+
+  /**
+   * @brief Upload parsed meshes, up to the frame budget. Must be called from
+   * the thread owning the GL context, once per frame.
+   */
+  void pump();
+
+  /**
+   * @brief Check whether every queued mesh has been uploaded
+   */
+  bool idle() const { return this->_pending == 0; }
+};
+
+#endif
@@ -29,6 +29,19 @@ class Camera
   static Camera *active_instance;
 
 public:
+  /**
+   * Values of the std140 Camera uniform block shared by every shader
+   * program. Frustum planes are (normal, distance) with normals pointing
+   * into the frustum, ordered left, right, bottom, top, near, far.
+   */
+  struct Uniforms {
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::mat4 view_projection;
+    glm::vec4 position;
+    glm::vec4 frustum[6];
+  };
+
   Camera(glm::vec3 position = glm::vec3(0, 0, 3.0f));
 
   /**
@@ -36,6 +49,16 @@ public:
    */
   glm::mat4 view();
 
+  /**
+   * @brief Return the position of the camera in world space
+   */
+  glm::vec3 position() const { return this->_pos; }
+
+  /**
+   * @brief Compute the camera uniform block for a projection
+   */
+  Uniforms uniforms(const glm::mat4 &projection);
+
   /**
    * @brief Move the camera along direction
    */
@@ -0,0 +1,117 @@
+#ifndef DYNAMIC_MESH_H
+#define DYNAMIC_MESH_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+#include "Mesh.h"
+#include "VertexFormat.h"
+
+/**
+ * Mesh whose vertices can be rewritten every frame, for geometry deformed on
+ * the CPU. The vertex buffer holds one copy of the vertices per frame in
+ * flight, each guarded by a fence, and draws read the newest copy with a
+ * base vertex. Writes go to a CPU copy and mark a dirty range; flush() moves
+ * on to the next copy and uploads only the bytes that changed since that
+ * copy was last current, so the GPU is never waited on while it reads a
+ * copy. With ARB_buffer_storage the copies are persistently mapped,
+ * otherwise they are updated with glBufferSubData.
+ *
+ * Indices, and with them the triangles, stay as created. Dynamic meshes live
+ * outside the geometry arena and are not evicted by a memory budget.
+ */
+class Dynamic_mesh : public Mesh
+{
+  // Copies of the vertices the GPU may read at once
+  static constexpr size_t COPIES = 3;
+
+  // GPU copy of the vertices, with the bytes it is missing
+  struct Copy {
+    GLsync fence;
+    size_t dirty_begin, dirty_end;
+  };
+
+  GLuint _vao, _vbo, _ebo;
+  size_t _copy_bytes;
+  std::byte *_mapped;
+
+  // Vertices as last written, the copies are updated from here
+  std::vector<std::byte> _vertices;
+  Copy _copies[COPIES];
+  size_t _current;
+
+  /**
+   * @brief Extend the dirty range of every copy
+   */
+  void mark(size_t begin, size_t end);
+
+  /**
+   * @brief Copy bytes of the CPU vertices into a GPU copy
+   */
+  void upload(size_t copy, size_t begin, size_t end);
+
+public:
+  /**
+   * @brief Create the buffers and upload the initial contents. Must be
+   * called from the thread owning the GL context.
+   *
+   * @param vertices Vertex buffer contents laid out as given by the format,
+   * a whole number of vertices
+   * @param indices Index buffer contents of the given index type
+   */
+  Dynamic_mesh(
+    std::span<const std::byte> vertices,
+    std::span<const std::byte> indices,
+    GLenum type,
+    const Vertex_format &format,
+    glm::vec3 colour
+  );
+  ~Dynamic_mesh() override;
+
+  /**
+   * @brief Size of the vertex data in bytes
+   */
+  size_t vertex_bytes() const { return this->_copy_bytes; }
+
+  /**
+   * @brief Overwrite part of the vertex data, drawn after the next flush()
+   *
+   * @param offset Byte offset within the vertex data
+   */
+  void write(size_t offset, std::span<const std::byte> bytes);
+
+  /**
+   * @brief Writable view of part of the vertex data, marked as changed. The
+   * view must not be written after the next flush().
+   *
+   * @param offset Byte offset within the vertex data
+   */
+  std::span<std::byte> edit(size_t offset, size_t bytes);
+
+  /**
+   * @brief Make the writes since the last flush visible to draws issued
+   * from now on. Call at most once per frame, before drawing; frames
+   * without writes need no flush.
+   */
+  void flush();
+
+  void draw(const Instance_range &instances, size_t lod = 0) const override;
+
+  // Dynamic meshes have their own vertex array, so they are always drawn
+  // on their own
+  bool indirect(
+    Geometry_arena::Indirect_draw &,
+    GLuint,
+    GLuint,
+    size_t = 0
+  ) const override
+  {
+    return false;
+  }
+};
+
+#endif
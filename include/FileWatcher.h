@@ -0,0 +1,59 @@
+#ifndef FILE_WATCHER_H
+#define FILE_WATCHER_H
+
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Watches directories with inotify on a background thread and collects the
+ * paths of files written or replaced in them. Editors that save by renaming
+ * a temporary file over the original are picked up as well.
+ */
+class File_watcher
+{
+  int _inotify;
+  int _wake;
+  std::thread _thread;
+
+  // Watched directories by watch descriptor
+  std::mutex _mutex;
+  std::unordered_map<int, std::string> _dirs;
+
+  // Files changed since the last call to changes()
+  std::set<std::string> _changed;
+
+  /**
+   * @brief Thread body, reads events until the watcher is destroyed
+   */
+  void work();
+
+public:
+  /**
+   * @brief Start the watcher thread. Without inotify the watcher stays
+   * empty and only warns.
+   */
+  File_watcher();
+  ~File_watcher();
+
+  File_watcher(const File_watcher &) = delete;
+  File_watcher &operator=(const File_watcher &) = delete;
+
+  /**
+   * @brief Watch the files directly inside a directory
+   *
+   * @return false if the directory cannot be watched
+   */
+  bool watch(const std::string &dir);
+
+  /**
+   * @brief Take the paths of files changed since the last call, each listed
+   * once
+   */
+  std::vector<std::string> changes();
+};
+
+#endif
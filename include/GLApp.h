@@ -7,19 +7,106 @@
 #include <cmath>
 #include <vector>
 
+#include "AssetLoader.h"
 #include "Camera.h"
+#include "DynamicMesh.h"
+#include "FileWatcher.h"
+#include "GlExtensions.h"
+#include "GpuMemory.h"
+#include "HandlePool.h"
+#include "MemoryBudget.h"
+#include "MeshRegistry.h"
 #include "Object.h"
+#include "ProgramCache.h"
+#include "RenderQueue.h"
 #include "Shader.h"
+#include "ShaderLibrary.h"
+#include "StreamBuffer.h"
+
+// Stable reference to an object placed in a GLApp
+using Object_handle = Handle_pool<Object>::Handle;
 
 class GLApp
 {
+  // Object drawn this frame
+  struct Draw {
+    const Object *object;
+    size_t lod;
+    // Shader_library features the object is drawn with
+    uint32_t features;
+    bool transparent;
+  };
+
+  // Objects sharing a mesh, level of detail and shader variant, drawn with
+  // one instanced call or as one command of a multi-draw call
+  struct Batch {
+    const Mesh *mesh;
+    size_t lod;
+    uint32_t features;
+    // Where the mesh uniforms and the first instance were written
+    size_t uniform_offset;
+    size_t instance_offset;
+    GLsizei count;
+    bool transparent;
+    bool indirect;
+  };
+
+  // Batches of one shader variant, arena pool and index type, drawn with
+  // one glMultiDrawElementsIndirect
+  struct Multi_draw {
+    uint32_t features;
+    size_t pool;
+    GLenum type;
+    // Where the commands and the per-draw mesh values were written
+    size_t command_offset;
+    size_t mesh_offset;
+    GLsizei count;
+  };
+
+  // GL state set while drawing a frame, redundant changes are skipped
+  struct Frame_stats {
+    size_t draws;
+    size_t programs;
+    size_t vertex_arrays;
+    size_t buffers;
+    size_t blend_states;
+  };
+
+  // Command of a batch drawn indirectly
+  struct Indirect_batch {
+    const Batch *batch;
+    Geometry_arena::Indirect_draw draw;
+  };
+
   int _width;
   int _height;
+  glm::mat4 _projection;
   const char *_title;
   GLFWwindow *_window;
-  Shader *_shader;
+  Shader_library *_shaders;
+  bool _lighting;
+  Program_cache *_programs;
+  Stream_buffer *_uniforms;
+  Stream_buffer *_instances;
+  // Indirect commands and per-draw mesh values, only made on GPUs with
+  // multi-draw indirect
+  Stream_buffer *_commands;
+  Stream_buffer *_mesh_values;
+  std::vector<Draw> _draws;
+  Render_queue _queue;
+  std::vector<Batch> _batches;
+  std::vector<Indirect_batch> _indirect;
+  std::vector<Multi_draw> _multi_draws;
+  std::vector<Geometry_arena::Draw_command> _command_data;
+  std::vector<Mesh::Uniforms> _mesh_data;
+  Frame_stats _stats;
   Camera _cam;
-  std::vector<Object *> _objects;
+  Handle_pool<Object> _objects;
+  Asset_loader _loader;
+  Mesh_registry _meshes;
+  float _lod_error;
+  Memory_budget _budget;
+  File_watcher _watcher;
   float dt;
 
   /**
@@ -32,6 +119,11 @@ class GLApp
   static void
   framebuffer_size_callback(GLFWwindow *window, int width, int height);
 
+  /**
+   * @brief Rebuild the projection matrix for the window size
+   */
+  void update_projection();
+
   /**
    * @brief Callback function for key press
    */
@@ -43,16 +135,36 @@ class GLApp
    */
   void on_key(int key, int scancode, int action, int mods);
 
-  // TODO(kalika): Make this a seperate class
   /**
-   * @brief Render objects to screen
+   * @brief Reload meshes and shaders whose files changed since the last
+   * frame. Failed reloads keep the previous version.
    */
-  void render();
+  void hot_reload();
 
   /**
-   * @brief Delete all object pointers
+   * @brief Shader variant features an object is drawn with
    */
-  void clear_objects();
+  uint32_t features(const Object &obj) const;
+
+  /**
+   * @brief Point a program's uniform blocks at the app's binding points
+   */
+  static void bind_blocks(Shader &shader);
+
+  /**
+   * @brief Move the batches of arena meshes into multi-draw calls, writing
+   * their commands and mesh values for the frame. Batches whose
+   * multi-draw variant is not ready stay on the instanced path.
+   *
+   * @param instance_offset Where the frame's first instance was written
+   */
+  void write_multi_draws(size_t instance_offset);
+
+  // TODO(kalika): Make this a seperate class
+  /**
+   * @brief Render objects to screen
+   */
+  void render();
 
 public:
   GLApp(int width, int height, const char *title = "My Window");
@@ -73,9 +185,60 @@ public:
   void run();
 
   /**
-   * @brief Add an object to render list from file
+   * @brief Add an object to render list from file. The mesh is loaded in the
+   * background, or shared with earlier objects placed from the same file,
+   * and the object is drawn once Object::ready() is true.
+   *
+   * @param options Processing applied to the mesh before upload
+   * @return Handle to the new object, which can be transformed straight
+   * away
+   */
+  Object_handle
+  add_object(const std::string &filepath, const Load_options &options = {});
+
+  /**
+   * @brief Add an object drawing a mesh the caller created, such as a
+   * Dynamic_mesh it keeps deforming
+   *
+   * @return Handle to the new object
+   */
+  Object_handle add_object(std::shared_ptr<Mesh> mesh);
+
+  /**
+   * @brief Remove an object from the render list
+   *
+   * @return false if the handle names no object
+   */
+  bool remove_object(Object_handle handle);
+
+  /**
+   * @brief Look up an object to transform it. The pointer is only valid
+   * until the next object is added or removed.
+   *
+   * @return The object, or nullptr if it has been removed
+   */
+  Object *object(Object_handle handle) { return this->_objects.get(handle); }
+
+  /**
+   * @brief Set how far in pixels a level of detail may stray from the full
+   * mesh on screen before a finer level is drawn
+   */
+  void set_lod_error(float pixels) { this->_lod_error = pixels; }
+
+  /**
+   * @brief Cap the GPU memory used by the app. Meshes not drawn recently are
+   * evicted when the cap is exceeded, and reloaded when drawn again.
+   *
+   * @param bytes Budget in bytes, 0 for no limit
+   */
+  void set_memory_budget(size_t bytes) { this->_budget.set_budget(bytes); }
+
+  /**
+   * @brief Add every mesh primitive of a binary glTF scene to the render list
+   *
+   * @return Handles to the new objects, placed with their node transforms
    */
-  void add_object(const std::string &filepath);
+  std::vector<Object_handle> add_scene(const std::string &filepath);
 };
 
 #endif
@@ -0,0 +1,285 @@
+#ifndef GEOMETRY_ARENA_H
+#define GEOMETRY_ARENA_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "GpuMemory.h"
+#include "RangeAllocator.h"
+#include "VertexFormat.h"
+
+/**
+ * Shared GPU storage for mesh geometry. Meshes with the same vertex layout
+ * are sub-allocated from one large vertex buffer and one large index buffer
+ * behind a single VAO, and drawn with a base vertex, so switching meshes
+ * does not rebind any vertex state. The arena tracks the bound vertex
+ * array, so geometry kept elsewhere must bind its own arrays through
+ * bind_vertex_array().
+ */
+class Geometry_arena
+{
+  // Buffers shared by every mesh of one vertex layout. Vertices are
+  // allocated in whole vertices and indices in 4-byte words, so index
+  // offsets suit every index type.
+  struct Pool {
+    Vertex_format format;
+    GLsizei stride;
+    GLuint VAO, VBO, EBO;
+    Range_allocator vertices;
+    Range_allocator words;
+  };
+
+  // Space taken by one mesh
+  struct Block {
+    size_t pool;
+    size_t first_vertex, vertex_count;
+    size_t first_word, word_count;
+    bool live;
+  };
+
+  // Part of a buffer carried over into a new buffer, in bytes
+  struct Move {
+    size_t from, to, size;
+  };
+
+  size_t _initial_bytes;
+  std::vector<Pool> _pools;
+  std::vector<Block> _blocks;
+  std::vector<uint32_t> _free_blocks;
+  GLuint _bound_vao;
+  size_t _vertex_array_binds;
+
+  /**
+   * @brief Find or create the pool for a vertex layout
+   */
+  size_t pool_for(const Vertex_format &format);
+
+  /**
+   * @brief Point the pool's VAO at its current buffers
+   */
+  void bind_buffers(Pool &pool);
+
+  /**
+   * @brief Reallocate a pool's buffers with room for at least the given
+   * number of extra vertices and index words
+   */
+  void grow(Pool &pool, size_t vertices, size_t words);
+
+  /**
+   * @brief Move the live blocks of a pool to the start of new buffers,
+   * leaving the free space in one piece at the end
+   *
+   * @param fit Size the new buffers to the live blocks instead of keeping
+   * the capacity
+   */
+  void compact(size_t pool, bool fit = false);
+
+  /**
+   * @brief Create a buffer and copy ranges of an old one into it, the old
+   * buffer is deleted. Both sizes are recorded in the GPU memory ledger.
+   */
+  static GLuint reallocate(
+    GLuint buffer,
+    size_t old_bytes,
+    size_t bytes,
+    std::span<const Move> moves,
+    Gpu_memory::Category category
+  );
+
+public:
+  // Returned for meshes that hold no geometry
+  static constexpr uint32_t NO_BLOCK = UINT32_MAX;
+
+  /**
+   * One draw of a multi-draw call, laid out as DrawElementsIndirectCommand
+   */
+  struct Draw_command {
+    GLuint count;
+    GLuint instance_count;
+    GLuint first_index;
+    GLint base_vertex;
+    GLuint base_instance;
+  };
+
+  /**
+   * Indirect command for a block, with what the multi-draw call drawing it
+   * must share with its other draws
+   */
+  struct Indirect_draw {
+    size_t pool;
+    GLenum type;
+    Draw_command command;
+  };
+
+  /**
+   * Buffer usage summed over every pool, in bytes
+   */
+  struct Stats {
+    size_t pools;
+    size_t blocks;
+    size_t vertex_capacity, vertex_used;
+    size_t index_capacity, index_used;
+    size_t free_ranges;
+    // Share of the free space outside the largest free range of each buffer
+    float fragmentation;
+  };
+
+  /**
+   * @brief Create an empty arena, buffers are made on first use
+   *
+   * @param initial_bytes Size of each buffer when a pool is created
+   */
+  Geometry_arena(size_t initial_bytes = 4 << 20);
+  ~Geometry_arena();
+
+  Geometry_arena(const Geometry_arena &) = delete;
+  Geometry_arena &operator=(const Geometry_arena &) = delete;
+
+  /**
+   * @brief Arena used by every Mesh
+   */
+  static Geometry_arena &shared();
+
+  /**
+   * @brief Reserve space for a mesh, growing the pool if needed
+   *
+   * @param format Layout of the vertex buffer contents
+   * @return Block holding the mesh
+   */
+  uint32_t allocate(
+    const Vertex_format &format, size_t vertex_bytes, size_t index_bytes
+  );
+
+  /**
+   * @brief Give a block's space back to its pool
+   */
+  void release(uint32_t block);
+
+  /**
+   * @brief Copy bytes into a block's vertices or indices
+   *
+   * @param target GL_ARRAY_BUFFER or GL_ELEMENT_ARRAY_BUFFER
+   * @param offset Byte offset within the block
+   */
+  void fill(
+    uint32_t block,
+    GLenum target,
+    size_t offset,
+    std::span<const std::byte> bytes
+  );
+
+  /**
+   * @brief Copy a block's vertices or indices back to the CPU, waiting for
+   * the GPU
+   *
+   * @param target GL_ARRAY_BUFFER or GL_ELEMENT_ARRAY_BUFFER
+   * @param offset Byte offset within the block
+   */
+  void read(
+    uint32_t block, GLenum target, size_t offset, std::span<std::byte> out
+  ) const;
+
+  /**
+   * @brief Bytes a block takes in its pool's buffers
+   */
+  size_t bytes(uint32_t block) const;
+
+  /**
+   * @brief Bind a vertex array, skipping the call if it is already bound
+   */
+  void bind_vertex_array(GLuint vao);
+
+  /**
+   * @brief Drop a vertex array about to be deleted from the binding cache,
+   * as GL may hand its name out again to a new array
+   */
+  void forget_vertex_array(GLuint vao);
+
+  /**
+   * @brief Number of vertex array binds issued since the arena was created,
+   * skipped ones not included
+   */
+  size_t vertex_array_binds() const { return this->_vertex_array_binds; }
+
+  /**
+   * @brief Draw instances of the triangles in a block, the shader must
+   * already be set up
+   *
+   * @param type Index type
+   * @param first_byte Byte offset of the first index within the block
+   * @param count Number of indices
+   * @param instances Per-instance data of the draw
+   */
+  void draw(
+    uint32_t block,
+    GLenum type,
+    size_t first_byte,
+    GLsizei count,
+    const Instance_range &instances
+  );
+
+  /**
+   * @brief Describe the same draw as draw() as an indirect command
+   *
+   * @param first_instance Instance the command starts at, counted from the
+   * start of the range given to multi_draw()
+   */
+  Indirect_draw indirect(
+    uint32_t block,
+    GLenum type,
+    size_t first_byte,
+    GLsizei count,
+    GLuint instance_count,
+    GLuint first_instance
+  ) const;
+
+  /**
+   * @brief Submit consecutive commands of the bound GL_DRAW_INDIRECT_BUFFER
+   * in one call. Needs Gl_extensions::multi_draw_indirect.
+   *
+   * @param pool Pool every command draws from
+   * @param type Index type of every command
+   * @param offset Byte offset of the first command in the buffer
+   * @param draw_count Number of commands
+   * @param instances Per-instance data the commands' base instances index
+   */
+  void multi_draw(
+    size_t pool,
+    GLenum type,
+    size_t offset,
+    GLsizei draw_count,
+    const Instance_range &instances
+  );
+
+  /**
+   * @brief Compact the pools whose free space is fragmented beyond a
+   * threshold. Cheap when nothing needs compacting, so it can run every
+   * frame.
+   *
+   * @param threshold Fragmentation above which a pool is compacted
+   */
+  void defragment(float threshold = 0.5f);
+
+  /**
+   * @brief Shrink the buffers of every pool to fit its live blocks, giving
+   * the free space back to the driver. Pools that already fit are skipped.
+   */
+  void trim();
+
+  /**
+   * @brief Report buffer usage and fragmentation
+   */
+  Stats stats() const;
+
+  /**
+   * @brief Delete every buffer while the GL context is still current.
+   * Blocks released afterwards are ignored.
+   */
+  void clear();
+};
+
+#endif
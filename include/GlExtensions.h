@@ -0,0 +1,107 @@
+#ifndef GL_EXTENSIONS_H
+#define GL_EXTENSIONS_H
+
+#include <glad/glad.h>
+
+#include <string>
+
+// ARB_buffer_storage, core in OpenGL 4.4
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#define GL_MAP_COHERENT_BIT 0x0080
+#define GL_DYNAMIC_STORAGE_BIT 0x0100
+#define GL_CLIENT_STORAGE_BIT 0x0200
+#endif
+
+// ARB_get_program_binary, core in OpenGL 4.1
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#define GL_PROGRAM_BINARY_FORMATS 0x87FF
+#endif
+
+// KHR_parallel_shader_compile and its ARB twin
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+// ARB_multi_draw_indirect and ARB_shader_storage_buffer_object, core in
+// OpenGL 4.3
+#ifndef GL_DRAW_INDIRECT_BUFFER
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#endif
+#ifndef GL_SHADER_STORAGE_BUFFER
+#define GL_SHADER_STORAGE_BUFFER 0x90D2
+#define GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT 0x90DF
+#endif
+
+/**
+ * Entry points beyond the OpenGL 3.3 core profile loaded by glad. Each is
+ * only used when its extension, or a core version including it, is
+ * available, so the 3.3 paths stay as fallbacks.
+ */
+class Gl_extensions
+{
+public:
+  using Buffer_storage_proc = void(APIENTRYP)(
+    GLenum target, GLsizeiptr size, const void *data, GLbitfield flags
+  );
+
+  using Get_program_binary_proc = void(APIENTRYP)(
+    GLuint program,
+    GLsizei size,
+    GLsizei *length,
+    GLenum *format,
+    void *binary
+  );
+  using Program_binary_proc = void(APIENTRYP)(
+    GLuint program, GLenum format, const void *binary, GLsizei length
+  );
+  using Program_parameteri_proc =
+    void(APIENTRYP)(GLuint program, GLenum name, GLint value);
+  using Max_shader_compiler_threads_proc = void(APIENTRYP)(GLuint count);
+  using Multi_draw_elements_indirect_proc = void(APIENTRYP)(
+    GLenum mode,
+    GLenum type,
+    const void *indirect,
+    GLsizei draw_count,
+    GLsizei stride
+  );
+
+  // ARB_buffer_storage
+  static bool buffer_storage;
+  static Buffer_storage_proc BufferStorage;
+
+  // ARB_get_program_binary
+  static bool program_binary;
+  static Get_program_binary_proc GetProgramBinary;
+  static Program_binary_proc ProgramBinary;
+  static Program_parameteri_proc ProgramParameteri;
+
+  // KHR_parallel_shader_compile, programs can be polled for completion
+  static bool parallel_shader_compile;
+  static Max_shader_compiler_threads_proc MaxShaderCompilerThreads;
+
+  // ARB_multi_draw_indirect with base instances, together with what the
+  // shaders need to read per-draw data: storage buffers, explicit bindings
+  // and gl_DrawIDARB from ARB_shader_draw_parameters
+  static bool multi_draw_indirect;
+  static Multi_draw_elements_indirect_proc MultiDrawElementsIndirect;
+
+  /**
+   * @brief Look up the supported extensions, once glad has loaded the core
+   * functions
+   *
+   * @param loader Function returning the address of a GL entry point
+   */
+  static void load(GLADloadproc loader);
+
+  /**
+   * @brief Check whether the context lists an extension
+   */
+  static bool has(const std::string &name);
+};
+
+#endif
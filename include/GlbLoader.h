@@ -0,0 +1,109 @@
+#ifndef GLB_LOADER_H
+#define GLB_LOADER_H
+
+#include <cstddef>
+#include <glm/glm.hpp>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Json.h"
+#include "MappedFile.h"
+#include "Mesh.h"
+#include "Object.h"
+
+/**
+ * Loader for binary glTF 2.0 (.glb) files. The file is mapped and accessor
+ * ranges are uploaded to the GPU straight from the binary chunk, without an
+ * intermediate copy. Primitives with normals, texture co-ordinates or
+ * colours are interleaved into packed vertices first.
+ */
+class Glb_loader
+{
+  // Range of the binary chunk described by an accessor
+  struct Accessor {
+    const std::byte *data;
+    size_t count;
+    size_t stride;
+    GLenum component;
+    std::string type;
+
+    // Bytes covered by the accessor, including the final element
+    size_t size() const;
+
+    // Elements as tightly packed floats of a number of components, at
+    // least as many as the accessor has
+    std::vector<float> floats(size_t components) const;
+  };
+
+  std::string _path;
+  Mapped_file _file;
+  Json _doc;
+  std::string_view _bin;
+
+  /**
+   * @brief Resolve an accessor into a range of the binary chunk
+   */
+  Accessor accessor(size_t index) const;
+
+  /**
+   * @brief Read a vertex attribute of a primitive as floats
+   *
+   * @param vertex_count Elements the attribute must have
+   * @param components Floats per vertex in the result
+   * @return The values, or nothing if the primitive lacks the attribute or
+   * stores it in an unsupported form
+   */
+  std::vector<float> attribute(
+    const Json &attributes,
+    const std::string &name,
+    size_t vertex_count,
+    size_t components
+  ) const;
+
+  // Uploaded primitives by glTF mesh and primitive index
+  using Mesh_table =
+    std::map<std::pair<size_t, size_t>, std::shared_ptr<Mesh>>;
+
+  /**
+   * @brief Upload a mesh primitive
+   *
+   * @return The mesh, or nullptr if the primitive is not supported
+   */
+  std::shared_ptr<Mesh> create_mesh(const Json &primitive) const;
+
+  /**
+   * @brief Create objects for a node and its children
+   *
+   * @param path Marks the nodes between the scene root and this one
+   * @param depth Number of those nodes
+   */
+  void visit(
+    size_t node,
+    const glm::mat4 &parent,
+    Mesh_table &meshes,
+    std::vector<Object> &objects,
+    std::vector<bool> &path,
+    size_t depth = 0
+  ) const;
+
+public:
+  /**
+   * @brief Map a .glb file and read its JSON chunk
+   *
+   * @param filepath Path of the .glb file
+   */
+  Glb_loader(const std::string &filepath);
+
+  /**
+   * @brief Create an object for every mesh primitive in the default scene.
+   * Must be called from the thread owning the GL context.
+   *
+   * @return Objects placed with their node transforms
+   */
+  std::vector<Object> create_objects() const;
+};
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef GPU_MEMORY_H
+#define GPU_MEMORY_H
+
+#include <cstddef>
+
+/**
+ * Ledger of the GPU memory allocated by the app, by category. Every buffer
+ * or texture allocation is recorded with its size when created and again
+ * when deleted, giving current totals and high-water marks. Only the thread
+ * owning the GL context records allocations.
+ */
+class Gpu_memory
+{
+public:
+  enum Category {
+    // Vertex buffers of meshes
+    MESH,
+    // Index buffers of meshes
+    INDEX,
+    // Buffers rewritten every frame
+    DYNAMIC,
+    TEXTURE,
+    CATEGORIES
+  };
+
+  /**
+   * Bytes allocated now and at most so far
+   */
+  struct Usage {
+    size_t current;
+    size_t peak;
+  };
+
+private:
+  Usage _categories[CATEGORIES];
+  Usage _total;
+
+public:
+  Gpu_memory();
+
+  Gpu_memory(const Gpu_memory &) = delete;
+  Gpu_memory &operator=(const Gpu_memory &) = delete;
+
+  /**
+   * @brief Ledger of the GL context
+   */
+  static Gpu_memory &shared();
+
+  /**
+   * @brief Record a new allocation
+   */
+  void allocate(Category category, size_t bytes);
+
+  /**
+   * @brief Record that an allocation was deleted
+   */
+  void release(Category category, size_t bytes);
+
+  /**
+   * @brief Usage of one category
+   */
+  Usage usage(Category category) const { return this->_categories[category]; }
+
+  /**
+   * @brief Usage summed over every category. The peak is the largest sum
+   * reached, not the sum of the category peaks.
+   */
+  Usage total() const { return this->_total; }
+
+  /**
+   * @brief Name of a category for reports
+   */
+  static const char *name(Category category);
+};
+
+#endif
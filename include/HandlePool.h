@@ -0,0 +1,192 @@
+#ifndef HANDLE_POOL_H
+#define HANDLE_POOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/**
+ * Objects stored contiguously and addressed by generational handles. A
+ * handle names a slot and the generation the slot had when the object was
+ * created, so handles to destroyed objects stop resolving even once the slot
+ * is reused. Live objects are packed at the front of one array for
+ * iteration; destroying one moves the last object into its place, so
+ * pointers into the pool only last until the next create or destroy, while
+ * handles stay valid for the object's lifetime.
+ *
+ * Creating and destroying objects is O(1) and, once the pool has reached
+ * its largest size, does not allocate.
+ */
+template <typename T> class Handle_pool
+{
+public:
+  /**
+   * Stable reference to a pooled object, a default handle names nothing
+   */
+  struct Handle {
+    uint32_t index = NONE;
+    uint32_t generation = 0;
+
+    bool operator==(const Handle &) const = default;
+  };
+
+private:
+  static constexpr uint32_t NONE = UINT32_MAX;
+
+  // Slots reaching this generation are retired rather than wrap around
+  static constexpr uint32_t RETIRED = UINT32_MAX;
+
+  // Live slots hold the position of their object, free slots the next free
+  // slot
+  struct Slot {
+    uint32_t dense;
+    uint32_t generation;
+  };
+
+  std::vector<T> _objects;
+  // Slot of each object in _objects
+  std::vector<uint32_t> _owners;
+  std::vector<Slot> _slots;
+  uint32_t _free;
+
+public:
+  /**
+   * @brief Create an empty pool
+   *
+   * @param capacity Objects to make room for up front
+   */
+  Handle_pool(size_t capacity = 0) : _free(NONE) { this->reserve(capacity); }
+
+  /**
+   * @brief Make room for a number of live objects without reallocating
+   */
+  void reserve(size_t capacity)
+  {
+    this->_objects.reserve(capacity);
+    this->_owners.reserve(capacity);
+    this->_slots.reserve(capacity);
+  }
+
+  /**
+   * @brief Construct an object in the pool
+   *
+   * @return Handle to the new object
+   */
+  template <typename... Args> Handle create(Args &&...args)
+  {
+    this->_objects.emplace_back(std::forward<Args>(args)...);
+
+    // Reuse the most recently freed slot
+    uint32_t index = this->_free;
+    if (index != NONE) {
+      this->_free = this->_slots[index].dense;
+    }
+    else {
+      index = static_cast<uint32_t>(this->_slots.size());
+      this->_slots.push_back({0, 0});
+    }
+
+    Slot &slot = this->_slots[index];
+    slot.dense = static_cast<uint32_t>(this->_objects.size() - 1);
+    this->_owners.push_back(index);
+    return {index, slot.generation};
+  }
+
+  /**
+   * @brief Destroy an object, filling its place with the last one
+   *
+   * @return false if the handle names no live object
+   */
+  bool destroy(Handle handle)
+  {
+    if (!this->valid(handle)) {
+      return false;
+    }
+
+    uint32_t dense = this->_slots[handle.index].dense;
+    uint32_t last = static_cast<uint32_t>(this->_objects.size() - 1);
+    if (dense != last) {
+      this->_objects[dense] = std::move(this->_objects[last]);
+      this->_owners[dense] = this->_owners[last];
+      this->_slots[this->_owners[dense]].dense = dense;
+    }
+    this->_objects.pop_back();
+    this->_owners.pop_back();
+
+    Slot &slot = this->_slots[handle.index];
+    if (++slot.generation != RETIRED) {
+      slot.dense = this->_free;
+      this->_free = handle.index;
+    }
+    return true;
+  }
+
+  /**
+   * @brief Check whether a handle names a live object
+   */
+  bool valid(Handle handle) const
+  {
+    if (handle.index >= this->_slots.size()) {
+      return false;
+    }
+    const Slot &slot = this->_slots[handle.index];
+    return slot.generation == handle.generation &&
+           slot.dense < this->_owners.size() &&
+           this->_owners[slot.dense] == handle.index;
+  }
+
+  /**
+   * @brief Look up an object
+   *
+   * @return The object, or nullptr if the handle names no live object
+   */
+  T *get(Handle handle)
+  {
+    return this->valid(handle)
+             ? &(this->_objects[this->_slots[handle.index].dense])
+             : nullptr;
+  }
+
+  const T *get(Handle handle) const
+  {
+    return this->valid(handle)
+             ? &(this->_objects[this->_slots[handle.index].dense])
+             : nullptr;
+  }
+
+  /**
+   * @brief Handle of the object at a position in iteration order
+   */
+  Handle handle(size_t position) const
+  {
+    uint32_t index = this->_owners[position];
+    return {index, this->_slots[index].generation};
+  }
+
+  /**
+   * @brief Destroy every object. Outstanding handles stop resolving.
+   */
+  void clear()
+  {
+    while (!this->_objects.empty()) {
+      this->destroy(this->handle(this->_objects.size() - 1));
+    }
+  }
+
+  size_t size() const { return this->_objects.size(); }
+  bool empty() const { return this->_objects.empty(); }
+
+  // Live objects, densely packed
+  T &operator[](size_t position) { return this->_objects[position]; }
+  const T &operator[](size_t position) const
+  {
+    return this->_objects[position];
+  }
+  auto begin() { return this->_objects.begin(); }
+  auto end() { return this->_objects.end(); }
+  auto begin() const { return this->_objects.begin(); }
+  auto end() const { return this->_objects.end(); }
+};
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef JSON_H
+#define JSON_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+
+/**
+ * Minimal read-only JSON document, enough for asset headers such as glTF.
+ */
+class Json
+{
+public:
+  using Array = std::vector<Json>;
+  using Members = std::vector<std::pair<std::string, Json>>;
+
+private:
+  std::variant<std::nullptr_t, bool, double, std::string, Array, Members>
+    _value;
+
+  class Parser;
+
+public:
+  Json() : _value(nullptr) {}
+
+  /**
+   * @brief Parse a JSON document
+   *
+   * @param text Document text
+   * @return Root value of the document
+   */
+  static Json parse(std::string_view text);
+
+  // Type checks
+  bool is_null() const;
+  bool is_number() const;
+  bool is_string() const;
+  bool is_array() const;
+  bool is_object() const;
+
+  /**
+   * @brief Check whether an object has a member
+   */
+  bool contains(const std::string &key) const;
+
+  /**
+   * @brief Member of an object, throws if it is missing
+   */
+  const Json &operator[](const std::string &key) const;
+
+  /**
+   * @brief Element of an array, throws if out of range
+   */
+  const Json &operator[](size_t index) const;
+
+  /**
+   * @brief Number of elements or members
+   */
+  size_t size() const;
+
+  // Value accessors, throw on type mismatch
+  bool boolean() const;
+  double number() const;
+  const std::string &string() const;
+
+  /**
+   * @brief Number held by a member, or a fallback if it is missing
+   */
+  double number(const std::string &key, double fallback) const;
+
+  /**
+   * @brief Number used as a count, index or offset, throws unless it is a
+   * non-negative integer
+   */
+  size_t integer() const;
+
+  /**
+   * @brief Integer held by a member, or a fallback if it is missing
+   */
+  size_t integer(const std::string &key, size_t fallback) const;
+};
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef LOAD_OPTIONS_H
+#define LOAD_OPTIONS_H
+
+#include <bit>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Per-asset switches for the processing done between parsing a mesh file and
+ * uploading it. Meshes compiled with different options are cached and shared
+ * separately.
+ */
+struct Load_options {
+  // Reorder triangles and vertices for the post-transform cache, overdraw
+  // and vertex fetch before upload
+  bool optimize = false;
+
+  // Upload positions as normalised 16-bit integers within the mesh bounds,
+  // trading precision for a smaller vertex buffer
+  bool quantize = false;
+
+  // Levels of detail generated below the full mesh, as triangle ratios of
+  // the full mesh in decreasing order
+  std::vector<float> lod_ratios;
+
+  /**
+   * @brief Identify the options in mesh caches and the mesh registry, 0 for
+   * the defaults
+   */
+  uint32_t key() const
+  {
+    if (!this->optimize && !this->quantize && this->lod_ratios.empty()) {
+      return 0;
+    }
+
+    // 32-bit FNV-1a over the fields
+    uint32_t hash = 0x811c9dc5u;
+    auto mix = [&hash](uint32_t value) {
+      hash = (hash ^ value) * 0x01000193u;
+    };
+    mix(this->optimize | this->quantize << 1);
+    for (float ratio : this->lod_ratios) {
+      mix(std::bit_cast<uint32_t>(ratio));
+    }
+    return hash == 0 ? 1 : hash;
+  }
+};
+
+#endif
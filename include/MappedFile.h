@@ -0,0 +1,41 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+class Mapped_file
+{
+  const char *_data;
+  size_t _size;
+
+public:
+  /**
+   * @brief Map a file read-only into memory
+   *
+   * @param filepath Path of the file to map
+   */
+  Mapped_file(const std::string &filepath);
+  ~Mapped_file();
+
+  Mapped_file(const Mapped_file &) = delete;
+  Mapped_file &operator=(const Mapped_file &) = delete;
+
+  /**
+   * @brief Pointer to the first byte of the mapping
+   */
+  const char *data() const { return this->_data; }
+
+  /**
+   * @brief Size of the mapped file in bytes
+   */
+  size_t size() const { return this->_size; }
+
+  /**
+   * @brief Contents of the file as a string view
+   */
+  std::string_view view() const { return {this->_data, this->_size}; }
+};
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef MEMORY_BUDGET_H
+#define MEMORY_BUDGET_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "AssetLoader.h"
+#include "LoadOptions.h"
+#include "Mesh.h"
+
+/**
+ * Ceiling on the GPU memory recorded by Gpu_memory. Once a frame ends over
+ * the budget, the meshes drawn least recently are evicted and the geometry
+ * arena is shrunk to fit what is left. Meshes loaded from a file are loaded
+ * from it again when next drawn, others keep a CPU copy of their data.
+ * Meshes drawn in the current frame are never evicted, so the budget can
+ * only be exceeded by what one frame draws.
+ */
+class Memory_budget
+{
+  // Where an evicted mesh is loaded from again, no path means a CPU copy
+  struct Source {
+    std::weak_ptr<Mesh> mesh;
+    std::string filepath;
+    Load_options options;
+  };
+
+  Asset_loader &_loader;
+  size_t _budget;
+  uint64_t _frame;
+  std::unordered_map<const Mesh *, Source> _meshes;
+  bool _warned;
+
+public:
+  /**
+   * @brief Start tracking with a budget in bytes, 0 for no limit
+   *
+   * @param loader Loader used to bring back meshes evicted to disk
+   */
+  Memory_budget(Asset_loader &loader, size_t budget = 0);
+
+  void set_budget(size_t bytes) { this->_budget = bytes; }
+  size_t budget() const { return this->_budget; }
+
+  /**
+   * @brief Let the budget evict a mesh
+   *
+   * @param filepath File the mesh was loaded from, empty to keep a CPU copy
+   * @param options Processing the mesh is loaded again with
+   */
+  void track(
+    const std::shared_ptr<Mesh> &mesh,
+    const std::string &filepath = "",
+    const Load_options &options = {}
+  );
+
+  /**
+   * @brief Mark a mesh as drawn this frame, bringing it back if it was
+   * evicted. CPU copies are uploaded straight away, meshes reloaded from
+   * disk become ready once the loader has uploaded them.
+   */
+  void use(const std::shared_ptr<Mesh> &mesh);
+
+  /**
+   * @brief Evict meshes until the recorded GPU memory fits the budget, once
+   * per frame after its draws
+   */
+  void enforce();
+};
+
+#endif
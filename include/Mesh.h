@@ -0,0 +1,203 @@
+#ifndef MESH_H
+#define MESH_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "GeometryArena.h"
+#include "MeshSimplifier.h"
+#include "VertexFormat.h"
+
+/**
+ * GPU copy of a mesh, stored in a block of the shared geometry arena. A mesh
+ * is shared by every Object placed with it, so identical geometry is only
+ * uploaded once.
+ */
+class Mesh
+{
+public:
+  /**
+   * Per-mesh values read by the shaders, laid out as the std140 Mesh uniform
+   * block
+   */
+  struct Uniforms {
+    // Maps quantised positions back to mesh space
+    glm::vec4 pos_scale;
+    glm::vec4 pos_offset;
+  };
+
+private:
+  friend class Asset_loader;
+  friend class Glb_loader;
+  friend class Memory_budget;
+  friend class Dynamic_mesh;
+
+  // Number told apart from other meshes' in render queue keys
+  uint32_t _id;
+
+  // Vertex data
+  uint32_t _block;
+  int index_count, vertex_count;
+  GLenum index_type;
+  bool _ready;
+
+  // Colour given by the source file
+  glm::vec3 _colour;
+
+  // Content hash of the file the data was loaded from, 0 if none
+  uint64_t _source_hash;
+
+  // Layout of the vertex buffer
+  Vertex_format _format;
+
+  // Index ranges of the levels of detail, level 0 is the full mesh
+  std::vector<Mesh_lod> _lods;
+
+  // Residency under a memory budget. Evicted meshes keep everything but
+  // their arena block, and a CPU copy of its contents when they have no
+  // file to be loaded from again.
+  uint64_t _last_drawn;
+  bool _evicted;
+  std::vector<std::byte> _saved_vertices;
+  std::vector<std::byte> _saved_indices;
+
+  // Bytes per index of an index type
+  static size_t index_size(GLenum type);
+
+  // Reserve arena space sized for the mesh without filling it. Positions are
+  // read as tightly packed float vec3s unless a format is given.
+  void create_buffers(
+    size_t vertex_bytes,
+    size_t index_bytes,
+    GLenum type = GL_UNSIGNED_INT,
+    const Vertex_format &format = {}
+  );
+
+  // Copy bytes into part of the vertex or index buffer
+  void
+  fill_buffer(GLenum target, size_t offset, std::span<const std::byte> bytes);
+
+  // Make the mesh drawable once its buffers are filled. Without levels of
+  // detail the whole index buffer is drawn.
+  void finish_load(glm::vec3 colour, std::span<const Mesh_lod> lods = {});
+
+  // Exchange GPU buffers and contents with another mesh, used to replace a
+  // mesh in use by a reloaded copy
+  void swap(Mesh &other);
+
+  // Give the arena block back, optionally reading its contents back first
+  void evict(bool keep_copy);
+
+  // Upload the CPU copy kept by evict() again
+  void restore();
+
+public:
+  /**
+   * @brief Create an empty mesh that becomes drawable once data has been
+   * loaded or streamed into it
+   */
+  Mesh();
+  virtual ~Mesh();
+
+  Mesh(const Mesh &) = delete;
+  Mesh &operator=(const Mesh &) = delete;
+
+  /**
+   * @brief Load packed mesh data into GPU's memory in one go
+   *
+   * @param vertices Vertex buffer contents laid out as given by the format
+   * @param indices Index buffer contents of the given index type
+   */
+  void load_object(
+    std::span<const std::byte> vertices,
+    std::span<const std::byte> indices,
+    GLenum type,
+    const Vertex_format &format,
+    glm::vec3 colour,
+    std::span<const Mesh_lod> lods = {}
+  );
+
+  /**
+   * @brief Number given to the mesh when created, unique until 2^32 meshes
+   * have been made
+   */
+  uint32_t id() const { return this->_id; }
+
+  /**
+   * @brief Check whether the mesh has been uploaded and can be drawn
+   */
+  bool ready() const { return this->_ready; }
+
+  /**
+   * @brief Check whether the mesh was evicted to stay within a memory budget
+   */
+  bool evicted() const { return this->_evicted; }
+
+  /**
+   * @brief Content hash of the file the mesh was last loaded from, 0 until
+   * the loader has filled it
+   */
+  uint64_t source_hash() const { return this->_source_hash; }
+
+  /**
+   * @brief Colour given by the source file
+   */
+  glm::vec3 colour() const { return this->_colour; }
+
+  /**
+   * @brief Layout of the vertex buffer, the shader needs the scale and offset
+   * of quantised positions
+   */
+  const Vertex_format &format() const { return this->_format; }
+
+  /**
+   * @brief Values for the Mesh uniform block of the shaders
+   */
+  Uniforms uniforms() const;
+
+  /**
+   * @brief Number of levels of detail, including the full mesh
+   */
+  size_t lod_count() const { return this->_lods.size(); }
+
+  /**
+   * @brief Pick the cheapest level of detail whose error stays under a
+   * number of pixels on screen
+   *
+   * @param distance Distance from the eye in mesh units
+   * @param projection Pixels covered by one unit at a distance of one unit
+   * @param pixel_error Largest error allowed on screen, in pixels
+   */
+  size_t pick_lod(float distance, float projection, float pixel_error) const;
+
+  /**
+   * @brief Draw a range of instances in one call, the shader must already be
+   * set up
+   *
+   * @param lod Level of detail to draw
+   */
+  virtual void draw(const Instance_range &instances, size_t lod = 0) const;
+
+  /**
+   * @brief Describe a draw of instances as a command for a multi-draw call
+   * on the geometry arena
+   *
+   * @param first_instance Instance the draw starts at, counted from the
+   * start of the range given to the call
+   * @param lod Level of detail to draw
+   * @return false if the mesh is not drawn from the arena
+   */
+  virtual bool indirect(
+    Geometry_arena::Indirect_draw &draw,
+    GLuint instance_count,
+    GLuint first_instance,
+    size_t lod = 0
+  ) const;
+};
+
+#endif
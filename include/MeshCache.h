@@ -0,0 +1,146 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+
+#include "MappedFile.h"
+#include "MeshSimplifier.h"
+#include "VertexLayout.h"
+
+/**
+ * Compiled binary copy of a mesh source file, stored next to the source
+ * with a ".mesh" suffix, or ".<options>.mesh" when compiled with load options.
+ * The file is a fixed header followed by the level of detail table, the raw
+ * position floats, the raw indices and the normal, texture co-ordinate and
+ * colour floats the mesh has, so it can be used in place once mapped.
+ */
+class Mesh_cache
+{
+public:
+  struct Header {
+    char magic[4];
+    uint32_t version;
+    // Source file the cache was compiled from
+    uint64_t source_size;
+    int64_t source_mtime;
+    uint64_t source_hash;
+    // Payload description
+    uint32_t vertex_count;
+    uint32_t index_count;
+    uint32_t lod_count;
+    float colour[3];
+    // Key of the Load_options the payload was compiled with
+    uint32_t options;
+    // Floats in each optional attribute stream
+    uint32_t normal_count;
+    uint32_t uv_count;
+    uint32_t colour_count;
+    uint32_t reserved;
+  };
+
+  // Source file as it was when parsed
+  struct Stamp {
+    uint64_t size;
+    int64_t mtime;
+    // content_hash() of the bytes that were parsed
+    uint64_t hash;
+  };
+
+  /**
+   * Incremental form of content_hash(), for sources read in pieces. Any
+   * split of the same bytes gives the same hash.
+   */
+  class Hasher
+  {
+    uint64_t _hash;
+    uint64_t _size;
+    // Bytes of a word not yet complete
+    char _tail[8];
+    size_t _tail_size;
+
+  public:
+    Hasher();
+
+    /**
+     * @brief Hash the next piece of the contents
+     */
+    void update(std::string_view bytes);
+
+    /**
+     * @brief Hash of everything passed in so far
+     */
+    uint64_t digest() const;
+  };
+
+private:
+  Mapped_file _file;
+  const Header *_header;
+
+  Mesh_cache(const std::string &cache_file);
+
+public:
+  /**
+   * @brief Open the cache for a source file
+   *
+   * @param source Path of the mesh source file
+   * @param options Load_options key the payload must have been compiled with
+   * @return Cache view, or nullptr if there is no cache or it is stale
+   */
+  static std::unique_ptr<Mesh_cache>
+  open(const std::string &source, uint32_t options = 0);
+
+  /**
+   * @brief Take the size and modification time of a source before it is
+   * parsed, leaving the hash to the parser
+   *
+   * @return false if the source cannot be stat'ed
+   */
+  static bool stamp(const std::string &source, Stamp &stamp);
+
+  /**
+   * @brief Compile mesh data into a cache file next to its source
+   *
+   * @param source Path of the mesh source file
+   * @param stamp Source as it was parsed, from stamp() and the parser
+   * @param streams Vertex data, empty streams are not stored
+   * @param lods Levels of detail as ranges of the indices
+   * @param options Load_options key the payload was compiled with
+   */
+  static void write(
+    const std::string &source,
+    const Stamp &stamp,
+    const Vertex_streams &streams,
+    std::span<const unsigned int> indices,
+    std::span<const Mesh_lod> lods,
+    glm::vec3 colour,
+    uint32_t options = 0
+  );
+
+  /**
+   * @brief Hash file contents for cache invalidation
+   */
+  static uint64_t content_hash(std::string_view bytes);
+
+  /**
+   * @brief Path of the cache file belonging to a source. Each set of
+   * Load_options gets its own file.
+   */
+  static std::string
+  cache_path(const std::string &source, uint32_t options = 0);
+
+  // Views into the mapped payload
+  std::span<const float> vertices() const;
+  std::span<const unsigned int> indices() const;
+  std::span<const Mesh_lod> lods() const;
+  Vertex_streams streams() const;
+  glm::vec3 colour() const;
+  // content_hash() of the source the payload was compiled from
+  uint64_t source_hash() const { return this->_header->source_hash; }
+};
+
+#endif
@@ -0,0 +1,110 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <climits>
+#include <cstddef>
+#include <span>
+#include <string>
+#include <vector>
+
+/**
+ * Load-time reordering of indexed triangle meshes. Triangles are ordered for
+ * the post-transform vertex cache with Tipsify (Sander et al. 2007), the
+ * resulting clusters are sorted outside-in to cut overdraw, and vertices are
+ * renumbered in order of first use so vertex fetch walks memory linearly.
+ * Vertices are tightly packed positions of 3 floats, other attributes are
+ * moved to match with remap_attribute().
+ */
+class Mesh_optimizer
+{
+public:
+  // Post-transform cache efficiency of an index buffer
+  struct Cache_stats {
+    // Average cache miss ratio, transformed vertices per triangle
+    double acmr;
+    // Average transform to vertex ratio, transformed vertices per vertex
+    double atvr;
+  };
+
+  // FIFO size the orderings target and are measured against
+  static constexpr unsigned CACHE_SIZE = 16;
+
+  // Marks vertices dropped when renumbering
+  static constexpr unsigned int UNUSED = UINT_MAX;
+
+  /**
+   * @brief Simulate a FIFO post-transform cache over an index buffer
+   *
+   * @param vertex_count Number of vertices the indices refer to
+   */
+  static Cache_stats analyze(
+    std::span<const unsigned int> indices,
+    size_t vertex_count,
+    unsigned cache_size = CACHE_SIZE
+  );
+
+  /**
+   * @brief Run every stage on a mesh in place and report the cache
+   * efficiency before and after
+   *
+   * @param name Printed with the report
+   * @return New index of each old vertex as from optimize_vertex_fetch(), or
+   * nothing if the mesh was left as it was
+   */
+  static std::vector<unsigned int> optimize(
+    const std::string &name,
+    std::vector<float> &vertices,
+    std::vector<unsigned int> &indices
+  );
+
+  /**
+   * @brief Order triangles for the vertex cache
+   *
+   * @param clusters Filled with the first triangle of every run that starts
+   * with a cold cache
+   */
+  static std::vector<unsigned int> optimize_vertex_cache(
+    std::span<const unsigned int> indices,
+    size_t vertex_count,
+    std::vector<size_t> &clusters,
+    unsigned cache_size = CACHE_SIZE
+  );
+
+  /**
+   * @brief Reorder clusters of cache-ordered triangles so those facing away
+   * from the centre of the mesh are drawn first. Clusters are split further
+   * while that costs less than threshold times their cache miss ratio.
+   *
+   * @param clusters Cluster starts from optimize_vertex_cache()
+   */
+  static std::vector<unsigned int> optimize_overdraw(
+    std::span<const unsigned int> indices,
+    std::span<const float> vertices,
+    std::span<const size_t> clusters,
+    double threshold = 1.05,
+    unsigned cache_size = CACHE_SIZE
+  );
+
+  /**
+   * @brief Renumber vertices in order of first use, dropping unused ones
+   *
+   * @return New index of each old vertex, UNUSED for dropped ones
+   */
+  static std::vector<unsigned int> optimize_vertex_fetch(
+    std::vector<float> &vertices, std::vector<unsigned int> &indices
+  );
+
+  /**
+   * @brief Move a per-vertex attribute stream to match renumbered vertices
+   *
+   * @param remap Result of optimize_vertex_fetch()
+   * @param components Floats per vertex in the stream
+   */
+  static void remap_attribute(
+    std::span<const unsigned int> remap,
+    size_t components,
+    std::vector<float> &values
+  );
+};
+
+#endif
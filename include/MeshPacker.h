@@ -0,0 +1,55 @@
+#ifndef MESH_PACKER_H
+#define MESH_PACKER_H
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+#include "Mesh.h"
+#include "VertexLayout.h"
+
+/**
+ * Conversion of parsed mesh data into compact GPU buffer layouts. Indices
+ * are narrowed to the smallest type that holds them, positions can be
+ * quantised to normalised 16-bit integers within the mesh bounds, and the
+ * other attributes are interleaved in packed types after the position.
+ */
+class Mesh_packer
+{
+public:
+  /**
+   * @brief Smallest index type that can hold every index
+   */
+  static GLenum index_type(std::span<const unsigned int> indices);
+
+  /**
+   * @brief Copy indices into a buffer of a narrower index type
+   */
+  static std::vector<std::byte>
+  pack_indices(std::span<const unsigned int> indices, GLenum type);
+
+  /**
+   * @brief Quantise tightly packed float positions to 16 bits per component,
+   * padded to 8 bytes per vertex to keep attributes 4-byte aligned
+   *
+   * @param format Set to the layout of the result and the scale and offset
+   * that map it back to mesh space
+   */
+  static std::vector<std::byte>
+  quantize(std::span<const float> vertices, Vertex_format &format);
+
+  /**
+   * @brief Interleave vertex streams into the smallest layout holding them.
+   * Positions stay floats or are quantised as by quantize(), normals become
+   * GL_INT_2_10_10_10_REV, texture co-ordinates half floats and colours
+   * RGBA8. Streams without an element for every position are left out.
+   *
+   * @param format Set to the layout of the result and the scale and offset
+   * that map positions back to mesh space
+   */
+  static std::vector<std::byte> interleave(
+    const Vertex_streams &streams, bool quantize, Vertex_format &format
+  );
+};
+
+#endif
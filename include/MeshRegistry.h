@@ -0,0 +1,84 @@
+#ifndef MESH_REGISTRY_H
+#define MESH_REGISTRY_H
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "LoadOptions.h"
+#include "Mesh.h"
+
+/**
+ * Table of live meshes keyed by source path, size, modification time and
+ * load options, so a file placed many times is only loaded and uploaded
+ * once. Files are only stat'ed here, never read, so lookups stay cheap on
+ * the render thread whatever the file size; the loader hashes contents on
+ * its workers instead. Meshes are owned by the objects using them and leave
+ * the table when the last one goes.
+ */
+class Mesh_registry
+{
+  // Version of a file as seen by stat
+  struct Stamp {
+    uint64_t size;
+    int64_t mtime;
+  };
+
+  // Live mesh and the options needed to load it again
+  struct Entry {
+    std::weak_ptr<Mesh> mesh;
+    Load_options options;
+  };
+
+  using Key = std::tuple<std::string, uint64_t, int64_t, uint32_t>;
+
+  std::map<Key, Entry> _meshes;
+
+  /**
+   * @brief Resolve a file's canonical path and stat it
+   *
+   * @return false if the file cannot be found
+   */
+  static bool
+  stamp(const std::string &filepath, std::string &path, Stamp &out);
+
+public:
+  // Mesh whose source file has changed since it was loaded
+  struct Stale {
+    std::shared_ptr<Mesh> mesh;
+    Load_options options;
+  };
+
+  /**
+   * @brief Look up the mesh for a file, creating an empty one if it is not
+   * loaded yet
+   *
+   * @param filepath Path of the mesh file
+   * @param options Processing the mesh is loaded with
+   * @param created Set to true if the caller has to load the new mesh
+   * @return Shared mesh for the file
+   */
+  std::shared_ptr<Mesh> acquire(
+    const std::string &filepath, const Load_options &options, bool &created
+  );
+
+  /**
+   * @brief Check a file for a new version after it has been written. Meshes
+   * loaded from an older version are filed under the new one, so they are
+   * shared again once reloaded.
+   *
+   * @return Meshes to reload, empty if the file is untouched or cannot be
+   * found. The loader skips reloads whose contents turn out unchanged.
+   */
+  std::vector<Stale> changed(const std::string &filepath);
+
+  /**
+   * @brief Number of distinct meshes still in use
+   */
+  size_t size();
+};
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef MESH_SIMPLIFIER_H
+#define MESH_SIMPLIFIER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+/**
+ * Range of the index buffer that draws one level of detail
+ */
+struct Mesh_lod {
+  uint32_t first;
+  uint32_t count;
+  // Farthest in mesh units any vertex of the full mesh was moved, which
+  // bounds the distance between the level and the full mesh
+  float error;
+};
+
+/**
+ * Quadric error metric simplification (Garland and Heckbert 1997). Edges are
+ * collapsed onto one of their endpoints, so every level of detail draws from
+ * the vertex buffer of the full mesh and only needs indices of its own.
+ * Vertices are tightly packed positions of 3 floats. Vertices split only by
+ * their other attributes are welded while simplifying, and each corner of
+ * the result then takes the split vertex that best matches its own.
+ */
+class Mesh_simplifier
+{
+public:
+  /**
+   * @brief Collapse edges, cheapest first, until the mesh is down to the
+   * target number of triangles or nothing more can be collapsed
+   *
+   * @param target_count Number of triangles to aim for
+   * @param error Set to the farthest any vertex was moved, which bounds the
+   * distance between the input and the simplified mesh
+   * @param attributes Per-vertex streams such as normals and UVs, of any
+   * number of floats per vertex, that corners are matched on
+   * @return Indices of the simplified mesh
+   */
+  static std::vector<unsigned int> simplify(
+    std::span<const float> vertices,
+    std::span<const unsigned int> indices,
+    size_t target_count,
+    float &error,
+    std::span<const std::span<const float>> attributes = {}
+  );
+
+  /**
+   * @brief Build a chain of levels of detail, each simplified from the one
+   * before it. The indices of every level are appended to the index buffer.
+   *
+   * @param ratios Triangle ratios of the full mesh, in decreasing order
+   * @param attributes Per-vertex streams that corners are matched on, as
+   * for simplify()
+   * @return Level 0 for the full mesh followed by one level per ratio that
+   * could be reached
+   */
+  static std::vector<Mesh_lod> build_lods(
+    std::span<const float> vertices,
+    std::vector<unsigned int> &indices,
+    std::span<const float> ratios,
+    std::span<const std::span<const float>> attributes = {}
+  );
+};
+
+#endif
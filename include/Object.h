@@ -4,53 +4,155 @@
 #include <fstream>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <memory>
+#include <optional>
+#include <span>
 #include <sstream>
 #include <string>
 #include <vector>
 
-#include "Shader.h"
+#include "LoadOptions.h"
+#include "Mesh.h"
+#include "MeshCache.h"
 
 using Vertices = std::vector<float>;
 using Indices = std::vector<unsigned int>;
 
 class Object
 {
+public:
   class Obj_spec
   {
+    // Compiled cache the data is read from, if one was valid
+    std::unique_ptr<Mesh_cache> _cache;
+
+    // Narrowed indices and interleaved vertices, if the layout changed
+    std::vector<std::byte> _packed_vertices;
+    std::vector<std::byte> _packed_indices;
+
+    // Parse the source, process it and write the cache
+    void compile(const std::string &filepath, const Load_options &options);
+
+    // Reject data that would make the GPU read out of bounds
+    void validate(const std::string &filepath) const;
+
+    // Parse the text source
+    void parse(const std::string &filepath, std::string_view text);
+
+    // Generate the levels of detail asked for by the options
+    void build_lods(const std::string &filepath, const Load_options &options);
+
+    // Convert the data to the buffer layouts it is uploaded in
+    void pack(const std::string &filepath, const Load_options &options);
+
   public:
     Vertices vertices;
     Indices indices;
+    // Optional per-vertex attributes, empty if the source has none
+    std::vector<float> normals;
+    std::vector<float> uvs;
+    std::vector<float> colours;
+    std::vector<Mesh_lod> lods;
     glm::vec3 colour;
-
-    Obj_spec(const std::string &filepath);
+    // Mesh_cache::content_hash() of the source the data came from
+    uint64_t source_hash;
+
+    // Layout of the buffers as uploaded
+    GLenum index_type;
+    Vertex_format format;
+
+    // Seconds spent in each loading stage
+    struct Timings {
+      double parse = 0;
+      double validate = 0;
+      double prepare = 0;
+      double cache = 0;
+      double pack = 0;
+    } timings;
+
+    Obj_spec(const std::string &filepath, const Load_options &options = {});
+
+    // Vertex and index data, from the cache or the parsed source
+    std::span<const float> vertex_data() const;
+    std::span<const unsigned int> index_data() const;
+    std::span<const Mesh_lod> lod_data() const;
+    Vertex_streams stream_data() const;
+
+    // Buffer contents in the layout given by index_type and format
+    std::span<const std::byte> vertex_bytes() const;
+    std::span<const std::byte> index_bytes() const;
   };
 
-  // Vertex data
-  GLuint VAO, VBO, EBO;
-  int index_count, vertex_count;
+private:
+  friend class Glb_loader;
 
-  // Visual data
-  glm::vec3 _colour;
+  // Shared vertex data
+  std::shared_ptr<Mesh> _mesh;
+
+  // Visual data, the mesh colour is used unless one is set
+  std::optional<glm::vec3> _colour;
+  float _opacity;
 
   // Orientation data
   glm::mat4 _transform;
 
-  // Constructor
-  Object(const Obj_spec &spec);
+public:
+  /**
+   * @brief Place an instance of a mesh. The object is drawn once the mesh is
+   * ready.
+   */
+  Object(std::shared_ptr<Mesh> mesh);
 
-  // Load Object data into GPU's memory
-  void load_object(const Vertices &vertices, const Indices &indices);
+  /**
+   * @brief Load a mesh file synchronously into a new mesh
+   */
+  Object(const std::string &filepath, const Load_options &options = {});
 
-public:
-  Object(const std::string &filepath);
-  ~Object();
+  /**
+   * @brief Check whether the mesh has been uploaded and can be drawn
+   */
+  bool ready() const { return this->_mesh->ready(); }
 
   /**
-   * @brief Draw object using GL functions and the shader provided
+   * @brief Mesh shared by this object
+   */
+  const std::shared_ptr<Mesh> &mesh() const { return this->_mesh; }
+
+  /**
+   * @brief Override the colour given by the mesh file
+   */
+  void set_colour(glm::vec3 colour);
+
+  /**
+   * @brief Set how opaque the object is. Objects below 1 are blended over
+   * the scene after every opaque object, farthest first.
+   */
+  void set_opacity(float opacity);
+
+  /**
+   * @brief Opacity the object is drawn with, 1 unless set
+   */
+  float opacity() const { return this->_opacity; }
+
+  /**
+   * @brief Pick the cheapest level of detail that looks the same as the full
+   * mesh to within a number of pixels
    *
-   * @param shader Shader program used to draw
+   * @param eye Position of the camera in world space
+   * @param projection Pixels covered by one unit at a distance of one unit
+   * @param pixel_error Largest error allowed on screen, in pixels
+   */
+  size_t lod(glm::vec3 eye, float projection, float pixel_error) const;
+
+  /**
+   * @brief Position of the object's origin in world space
+   */
+  glm::vec3 position() const { return glm::vec3(this->_transform[3]); }
+
+  /**
+   * @brief Per-instance values the object is drawn with
    */
-  void draw(Shader &shader);
+  Instance instance() const;
 
   /**
    * @brief Move the object along the distance vector
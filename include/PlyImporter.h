@@ -0,0 +1,86 @@
+#ifndef PLY_IMPORTER_H
+#define PLY_IMPORTER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * Importer for binary little-endian PLY files. Vertex positions and face
+ * index lists are converted in bulk, with SIMD fast paths for float32
+ * positions and uint8-counted int32 triangle lists.
+ */
+class Ply_importer
+{
+  enum Ply_type { CHAR, UCHAR, SHORT, USHORT, INT, UINT, FLOAT, DOUBLE };
+
+  struct Property {
+    std::string name;
+    Ply_type type;
+    // List properties store a count followed by that many items
+    bool is_list;
+    Ply_type count_type;
+  };
+
+  struct Element {
+    std::string name;
+    size_t count;
+    std::vector<Property> properties;
+  };
+
+  std::vector<Element> _elements;
+  const std::string &_path;
+
+  /**
+   * @brief Parse the text header
+   *
+   * @return Offset of the binary body
+   */
+  size_t read_header(std::string_view text);
+
+  /**
+   * @brief Read vertex positions
+   *
+   * @return Pointer past the last vertex
+   */
+  const char *
+  read_vertices(const Element &element, const char *data, const char *end);
+
+  /**
+   * @brief Read faces, triangulating polygons
+   *
+   * @return Pointer past the last face
+   */
+  const char *
+  read_faces(const Element &element, const char *data, const char *end);
+
+  /**
+   * @brief Skip over an element that is not used
+   *
+   * @return Pointer past the element
+   */
+  const char *
+  skip_element(const Element &element, const char *data, const char *end) const;
+
+public:
+  std::vector<float> vertices;
+  std::vector<unsigned int> indices;
+  // Mesh_cache::content_hash() of the file that was parsed
+  uint64_t source_hash;
+
+  /**
+   * @brief Import a PLY file
+   *
+   * @param filepath Path of the PLY file
+   */
+  Ply_importer(const std::string &filepath);
+
+  /**
+   * @brief Check whether a file should be read by this importer
+   */
+  static bool handles(const std::string &filepath);
+};
+
+#endif
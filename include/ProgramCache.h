@@ -0,0 +1,70 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/**
+ * Linked shader programs saved as driver binaries, so later runs skip the
+ * GLSL compiler. Each file is named after the hash of the program's sources
+ * and holds a fixed header followed by the binary. Binaries from another
+ * driver, or ones the driver rejects, are recompiled and overwritten.
+ */
+class Program_cache
+{
+  struct Header {
+    char magic[4];
+    uint32_t version;
+    // Hash of the vendor, renderer and version strings of the driver
+    uint64_t driver_hash;
+    uint64_t source_hash;
+    uint32_t format;
+    uint32_t length;
+  };
+
+  std::string _dir;
+  uint64_t _driver_hash;
+  bool _enabled;
+
+  /**
+   * @brief Path of the cache file for a program
+   */
+  std::string path(uint64_t source_hash) const;
+
+public:
+  /**
+   * @brief Open a cache directory, creating it if needed. Must be called
+   * with a current GL context. Without program binary support, or without
+   * any binary format, the cache stays disabled.
+   */
+  Program_cache(const std::string &dir);
+
+  /**
+   * @brief Check whether binaries are loaded and stored
+   */
+  bool enabled() const { return this->_enabled; }
+
+  /**
+   * @brief Hash the sources of a program to identify its binary
+   */
+  static uint64_t
+  source_hash(std::string_view vert_source, std::string_view frag_source);
+
+  /**
+   * @brief Load the cached binary of a program
+   *
+   * @param program Program object without shaders attached
+   * @return true if the program was loaded and linked
+   */
+  bool load(GLuint program, uint64_t source_hash) const;
+
+  /**
+   * @brief Save the binary of a linked program, failures are only reported
+   */
+  void store(GLuint program, uint64_t source_hash) const;
+};
+
+#endif
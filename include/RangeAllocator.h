@@ -0,0 +1,80 @@
+#ifndef RANGE_ALLOCATOR_H
+#define RANGE_ALLOCATOR_H
+
+#include <cstddef>
+#include <map>
+#include <set>
+#include <utility>
+
+/**
+ * Best-fit allocator of ranges within a linear space of fixed capacity, such
+ * as a GPU buffer. Only the free ranges are tracked, so callers keep the
+ * offset and size of what they allocate. Neighbouring free ranges are merged
+ * on release.
+ */
+class Range_allocator
+{
+  size_t _capacity;
+  size_t _used;
+
+  // Free ranges by offset, and by size for best-fit lookups
+  std::map<size_t, size_t> _free;
+  std::set<std::pair<size_t, size_t>> _by_size;
+
+  /**
+   * @brief Add or remove a free range in both indices
+   */
+  void insert(size_t offset, size_t size);
+  void erase(std::map<size_t, size_t>::iterator range);
+
+public:
+  /**
+   * @brief Start with the whole capacity free
+   */
+  Range_allocator(size_t capacity = 0);
+
+  /**
+   * @brief Take the smallest free range that fits
+   *
+   * @param offset Set to the start of the allocated range
+   * @return false if no free range is large enough
+   */
+  bool allocate(size_t size, size_t &offset);
+
+  /**
+   * @brief Return a range taken with allocate()
+   */
+  void release(size_t offset, size_t size);
+
+  /**
+   * @brief Extend the space, the new part starts out free
+   */
+  void grow(size_t capacity);
+
+  /**
+   * @brief Mark everything below used as allocated and the rest up to a new
+   * capacity as free, for after the contents have been compacted
+   */
+  void reset(size_t used, size_t capacity);
+
+  size_t capacity() const { return this->_capacity; }
+  size_t used() const { return this->_used; }
+
+  /**
+   * @brief Number of separate free ranges
+   */
+  size_t free_ranges() const { return this->_free.size(); }
+
+  /**
+   * @brief Size of the largest free range
+   */
+  size_t largest_free() const;
+
+  /**
+   * @brief Share of the free space outside the largest free range, from 0
+   * when all free space is in one piece towards 1
+   */
+  float fragmentation() const;
+};
+
+#endif
@@ -0,0 +1,97 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+/**
+ * Draws of one frame, each submitted as a 64-bit sort key and a payload
+ * naming the draw, then ordered with a radix sort so that executing them in
+ * order changes as little GL state as possible.
+ *
+ * Opaque draws sort by program, then mesh and level of detail, then front
+ * to back so early depth testing rejects hidden fragments. Transparent draws
+ * sort after every opaque one and back to front, as blending needs, with
+ * program and mesh only breaking ties.
+ */
+class Render_queue
+{
+public:
+  // Passes in the order they are drawn
+  enum Pass : uint32_t {
+    OPAQUE = 0,
+    TRANSPARENT = 1,
+  };
+
+  // Width of each key field. Wider values are truncated, which can only
+  // cost extra state changes, never a wrong draw.
+  static constexpr unsigned PASS_BITS = 2;
+  static constexpr unsigned PROGRAM_BITS = 8;
+  static constexpr unsigned MESH_BITS = 24;
+  static constexpr unsigned LOD_BITS = 4;
+  static constexpr unsigned DEPTH_BITS = 24;
+
+  /**
+   * One submitted draw
+   */
+  struct Item {
+    uint64_t key;
+    uint32_t payload;
+  };
+
+private:
+  std::vector<Item> _items;
+  std::vector<Item> _scratch;
+
+public:
+  /**
+   * @brief Pack the state a draw needs into a sort key
+   *
+   * @param program Shader program, such as its feature bits
+   * @param mesh Small integer naming the mesh
+   * @param depth Distance from the eye, 0 at the eye and 1 at the far plane
+   */
+  static uint64_t
+  key(Pass pass, uint32_t program, uint32_t mesh, size_t lod, float depth);
+
+  /**
+   * @brief Pass a key was made for
+   */
+  static Pass pass(uint64_t key)
+  {
+    return static_cast<Pass>(key >> (64 - PASS_BITS));
+  }
+
+  /**
+   * @brief Drop every draw, keeping the memory for the next frame
+   */
+  void clear() { this->_items.clear(); }
+
+  /**
+   * @brief Submit a draw
+   *
+   * @param payload Index of the draw in the caller's own list
+   */
+  void push(uint64_t key, uint32_t payload)
+  {
+    this->_items.push_back({key, payload});
+  }
+
+  /**
+   * @brief Order the draws by key. Stable, so equal keys keep their
+   * submission order.
+   */
+  void sort();
+
+  /**
+   * @brief Draws in submission order, or in key order once sorted
+   */
+  std::span<const Item> items() const { return this->_items; }
+
+  size_t size() const { return this->_items.size(); }
+  bool empty() const { return this->_items.empty(); }
+};
+
+#endif
@@ -5,14 +5,48 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <cstddef>
+#include <cstdint>
 #include <fstream>
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <type_traits>
+#include <vector>
+
+#include "ProgramCache.h"
 
 class Shader
 {
+  // Active uniform outside any block, with the last value set
+  struct Uniform_slot {
+    std::string name;
+    GLint location;
+    GLenum type;
+    bool set;
+    alignas(16) std::byte value[sizeof(glm::mat4)];
+  };
+
+  // Active uniform block
+  struct Block_slot {
+    std::string name;
+    GLuint index;
+    GLint size;
+  };
+
+  // Nesting allowed for #include, which also stops include cycles
+  static constexpr int MAX_INCLUDE_DEPTH = 16;
+
   GLuint prog_id;
+  bool _cached;
+  // Compiling or linking until finish() reads the results
+  bool _pending;
+  GLuint _vert_shader;
+  GLuint _frag_shader;
+  const Program_cache *_cache;
+  uint64_t _source_hash;
+  std::vector<Uniform_slot> _uniforms;
+  std::vector<Block_slot> _blocks;
 
   /**
    * @brief Check for compilation errors
@@ -23,25 +57,142 @@ class Shader
   static void check_errors(GLuint object, bool shader);
 
   /**
-   * @brief Load shader from text file
+   * @brief Check the compile and link results, then cache and reflect the
+   * program. Throws and deletes the program on errors.
+   */
+  void finish();
+
+  /**
+   * @brief Load shader from text file. Lines of the form #include "file"
+   * are replaced by that file, found relative to the including one.
    * @param path Path to text file
+   * @param depth Nesting of the file within includes
    * @return Shader code as a string
    */
-  static std::string load_shader(const std::string &path);
+  static std::string load_shader(const std::string &path, int depth = 0);
+
+  /**
+   * @brief Add a #define for each name after the #version line
+   */
+  static std::string
+  define(const std::string &source, const std::vector<std::string> &defines);
+
+  /**
+   * @brief Read the active uniforms and uniform blocks of the linked program
+   */
+  void reflect();
+
+  /**
+   * @brief Find the slot of a uniform by name and type
+   *
+   * @return Slot index, or -1 if the program has no such uniform
+   */
+  int find(const std::string &name, GLenum type) const;
+
+  /**
+   * @brief Record a new value for a slot
+   *
+   * @return false if the slot is invalid or already holds the value
+   */
+  bool changed(int slot, const void *value, size_t bytes);
+
+  /**
+   * @brief GL type of a uniform set from a C++ type
+   */
+  template <typename T> static constexpr GLenum gl_type()
+  {
+    if constexpr (std::is_same_v<T, int>) {
+      return GL_INT;
+    }
+    else if constexpr (std::is_same_v<T, float>) {
+      return GL_FLOAT;
+    }
+    else if constexpr (std::is_same_v<T, glm::vec3>) {
+      return GL_FLOAT_VEC3;
+    }
+    else if constexpr (std::is_same_v<T, glm::vec4>) {
+      return GL_FLOAT_VEC4;
+    }
+    else {
+      static_assert(std::is_same_v<T, glm::mat4>, "Unsupported uniform");
+      return GL_FLOAT_MAT4;
+    }
+  }
 
 public:
-  Shader(const std::string &vert_file, const std::string &frag_file);
+  // Binding point of the Camera uniform block in every program
+  static constexpr GLuint CAMERA_BLOCK = 0;
+
+  /**
+   * Uniform resolved once by name, setting an invalid handle does nothing
+   */
+  template <typename T> struct Uniform {
+    int slot = -1;
+    bool valid() const { return this->slot >= 0; }
+  };
+
+  /**
+   * @brief Build a program from vertex and fragment shader files
+   *
+   * @param cache Program binaries to load from and add to, if any
+   * @param defines Macros defined in both stages
+   * @param wait If false, compile in the background and leave errors to
+   * ready()
+   */
+  Shader(
+    const std::string &vert_file,
+    const std::string &frag_file,
+    const Program_cache *cache = nullptr,
+    const std::vector<std::string> &defines = {},
+    bool wait = true
+  );
   ~Shader();
 
+  /**
+   * @brief Check whether the program can be used. Without parallel compile
+   * support this waits for the driver the first time.
+   *
+   * @return false while the driver is still compiling
+   */
+  bool ready();
+
+  /**
+   * @brief Check whether the program was loaded from a cached binary
+   */
+  bool cached() const { return this->_cached; }
+
   /**
    * @brief Use the initialised shader program
    */
   void use() const;
 
-  // Uniform Utility functions
-  void set_float(const std::string &name, float value);
-  void set_vec3(const std::string &name, glm::vec3 value);
-  void set_mat4(const std::string &name, glm::mat4 value);
+  /**
+   * @brief Resolve a uniform for setting later. Names are only looked up
+   * here, a missing uniform or one of another type gives an invalid handle.
+   */
+  template <typename T> Uniform<T> uniform(const std::string &name) const
+  {
+    return {this->find(name, Shader::gl_type<T>())};
+  }
+
+  /**
+   * @brief Point a uniform block at an indexed binding point, blocks the
+   * program does not use are ignored
+   */
+  void bind_block(const std::string &name, GLuint binding);
+
+  /**
+   * @brief Size in bytes of a uniform block, 0 if the program has none
+   */
+  GLint block_size(const std::string &name) const;
+
+  // Uniform Utility functions, the program must be in use. Values equal to
+  // the last one set are skipped.
+  void set(Uniform<int> uniform, int value);
+  void set(Uniform<float> uniform, float value);
+  void set(Uniform<glm::vec3> uniform, glm::vec3 value);
+  void set(Uniform<glm::vec4> uniform, glm::vec4 value);
+  void set(Uniform<glm::mat4> uniform, const glm::mat4 &value);
 };
 
 #endif
@@ -0,0 +1,118 @@
+#ifndef SHADER_LIBRARY_H
+#define SHADER_LIBRARY_H
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ProgramCache.h"
+#include "Shader.h"
+
+/**
+ * Permutations of one vertex and fragment shader pair, compiled with a
+ * #define for each enabled feature. Variants are built the first time they
+ * are asked for and compile in the background, while a fallback program
+ * built up front draws in their place.
+ */
+class Shader_library
+{
+public:
+  /**
+   * @brief Called on every program once it is ready, before it draws
+   */
+  using Setup = void (*)(Shader &shader);
+
+  // Feature bits, each defines the macro of the same name
+  enum Feature : uint32_t {
+    // Positions are stored as normalised integers, rescaled in the shader
+    QUANTIZED = 1 << 0,
+    // Shade with a directional light
+    LIGHTING = 1 << 1,
+    // Vertices carry normals, used for lighting in place of face normals
+    NORMALS = 1 << 2,
+    // Drawn by glMultiDrawElementsIndirect, reading per-draw mesh values
+    // from a storage buffer by gl_DrawIDARB
+    MULTI_DRAW = 1 << 3,
+  };
+
+private:
+  struct Variant {
+    // Null if the variant failed to build
+    std::unique_ptr<Shader> shader;
+    bool setup;
+  };
+
+  std::string _vert_file;
+  std::string _frag_file;
+  const Program_cache *_cache;
+  Setup _setup;
+  uint32_t _fallback_features;
+  std::unique_ptr<Shader> _fallback;
+  // Fallback started by reload(), drawing nothing until it replaces the
+  // current one
+  std::unique_ptr<Shader> _next_fallback;
+  std::map<uint32_t, Variant> _variants;
+
+  /**
+   * @brief Start building the program for a feature set
+   */
+  std::unique_ptr<Shader> build(uint32_t features, bool wait) const;
+
+  /**
+   * @brief Macro names of a feature set
+   */
+  static std::vector<std::string> defines(uint32_t features);
+
+public:
+  /**
+   * @brief Build the fallback program, waiting for it. Throws on errors.
+   *
+   * @param cache Program binaries to load from and add to, if any
+   * @param setup Applied to each program once it is ready
+   * @param fallback_features Features of the fallback program, which must
+   * draw every variant's meshes correctly
+   */
+  Shader_library(
+    const std::string &vert_file,
+    const std::string &frag_file,
+    const Program_cache *cache,
+    Setup setup,
+    uint32_t fallback_features
+  );
+
+  /**
+   * @brief Program for a feature set, or the fallback until it has compiled.
+   * Failed variants report their error once and keep using the fallback.
+   */
+  Shader &get(uint32_t features);
+
+  /**
+   * @brief The program drawing in place of variants that are not ready
+   */
+  Shader &fallback() { return *(this->_fallback); }
+
+  /**
+   * @brief Start rebuilding from the source files. The new fallback
+   * compiles in the background while the current programs keep drawing.
+   * Throws if the sources cannot be read.
+   */
+  void reload();
+
+  /**
+   * @brief Swap in the fallback started by reload() once it is ready,
+   * dropping the variants so they are rebuilt as they are next used. On
+   * errors this throws and keeps every current program.
+   *
+   * @return true if the new programs were swapped in
+   */
+  bool finish_reload();
+
+  /**
+   * @brief Number of variants still compiling
+   */
+  size_t pending() const;
+};
+
+#endif
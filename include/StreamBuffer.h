@@ -0,0 +1,123 @@
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * Ring buffer for data rewritten every frame, such as uniforms and instance
+ * attributes. Each frame in flight gets its own region of a persistently
+ * mapped buffer, guarded by a fence so the CPU never overwrites data the GPU
+ * still reads.
+ * Without ARB_buffer_storage the frame is staged on the CPU and uploaded
+ * into an orphaned buffer in one call instead.
+ *
+ * A frame writes all of its data first, then flushes, then binds ranges by
+ * offset for its draws.
+ */
+class Stream_buffer
+{
+  // Frames that may be in flight at once
+  static constexpr size_t FRAMES = 3;
+
+  GLenum _target;
+  GLuint _buffer;
+  size_t _alignment;
+
+  // Bytes per frame region, a multiple of the alignment
+  size_t _frame_bytes;
+
+  // Persistent mapping, or the CPU copy of the frame when orphaning
+  std::byte *_mapped;
+  std::vector<std::byte> _staging;
+
+  // Region written this frame and how much of it is used
+  size_t _frame;
+  size_t _head;
+  GLsync _fences[FRAMES];
+
+  /**
+   * @brief Create the buffer with room for a number of bytes per frame
+   */
+  void create(size_t frame_bytes);
+
+  /**
+   * @brief Delete the buffer once the GPU is done with every region
+   */
+  void destroy();
+
+  /**
+   * @brief Block until the GPU has passed a fence, then delete it
+   */
+  static void wait(GLsync &fence);
+
+public:
+  /**
+   * @brief Create a stream buffer. Must be called from the thread owning the
+   * GL context.
+   *
+   * @param target Binding target, such as GL_UNIFORM_BUFFER
+   * @param frame_bytes Initial number of bytes written per frame
+   */
+  Stream_buffer(GLenum target, size_t frame_bytes);
+  ~Stream_buffer();
+
+  Stream_buffer(const Stream_buffer &) = delete;
+  Stream_buffer &operator=(const Stream_buffer &) = delete;
+
+  /**
+   * @brief Start writing the next frame's region, waiting for the GPU if it
+   * is still reading it
+   *
+   * @param bytes Bytes about to be written, including alignment padding.
+   * The buffer grows if they do not fit.
+   */
+  void begin_frame(size_t bytes);
+
+  /**
+   * @brief Bytes taken by a write of the given size, including padding
+   */
+  size_t aligned(size_t bytes) const;
+
+  /**
+   * @brief Copy data into the frame
+   *
+   * @return Offset of the data in the buffer, for bind()
+   */
+  size_t write(const void *data, size_t bytes);
+
+  template <typename T> size_t write(const T &value)
+  {
+    return this->write(&value, sizeof(T));
+  }
+
+  /**
+   * @brief Make the frame's writes visible to the GPU, before any draw that
+   * reads them
+   */
+  void flush();
+
+  /**
+   * @brief Bind a written range to an indexed binding point
+   */
+  void bind(GLuint index, size_t offset, size_t bytes) const;
+
+  /**
+   * @brief Fence the frame once its draws have been issued
+   */
+  void end_frame();
+
+  /**
+   * @brief Buffer object, for reading ranges as vertex attributes
+   */
+  GLuint buffer() const { return this->_buffer; }
+
+  /**
+   * @brief Check whether the buffer is persistently mapped
+   */
+  bool persistent() const { return this->_mapped != nullptr; }
+};
+
+#endif
@@ -0,0 +1,100 @@
+#ifndef VERTEX_FORMAT_H
+#define VERTEX_FORMAT_H
+
+#include <glad/glad.h>
+
+#include <array>
+#include <cstddef>
+#include <glm/glm.hpp>
+
+// Attribute locations the shaders declare
+enum Vertex_location : GLuint {
+  POSITION = 0,
+  NORMAL = 1,
+  TEXCOORD = 2,
+  COLOUR = 3,
+  // Per-instance attributes, the model matrix takes a location per column
+  INSTANCE_MODEL = 4,
+  INSTANCE_COLOUR = 8,
+};
+
+/**
+ * One attribute of an interleaved vertex, as passed to glVertexAttribPointer
+ */
+struct Vertex_attribute {
+  GLuint location;
+  GLint components;
+  GLenum type;
+  GLboolean normalized;
+  GLsizei offset;
+
+  bool operator==(const Vertex_attribute &) const = default;
+};
+
+/**
+ * Layout of the attributes in a vertex buffer. The position always comes
+ * first; attributes the buffer lacks read the shader's default value.
+ */
+struct Vertex_format {
+  static constexpr size_t MAX_ATTRIBUTES = 4;
+
+  std::array<Vertex_attribute, MAX_ATTRIBUTES> attributes = {
+    {{POSITION, 3, GL_FLOAT, GL_FALSE, 0}}
+  };
+  size_t attribute_count = 1;
+  GLsizei stride = 3 * sizeof(float);
+  // Positions as read by the vertex shader are mapped back to mesh space
+  // with position * scale + offset
+  glm::vec3 scale = glm::vec3(1.0f);
+  glm::vec3 offset = glm::vec3(0.0f);
+
+  /**
+   * @brief Attribute fed to a shader location
+   *
+   * @return The attribute, or nullptr if the buffer lacks it
+   */
+  const Vertex_attribute *find(GLuint location) const;
+
+  /**
+   * @brief Check whether positions are stored as normalised integers
+   */
+  bool quantized() const { return this->attributes[0].type != GL_FLOAT; }
+
+  /**
+   * @brief Check whether two buffers can share vertex array state. The
+   * position mapping is a uniform, so it may differ.
+   */
+  bool same_layout(const Vertex_format &other) const;
+
+  /**
+   * @brief Point the bound vertex array at the bound GL_ARRAY_BUFFER in
+   * this layout, disabling the locations it does not cover
+   */
+  void apply() const;
+};
+
+/**
+ * Per-instance values, read from an instance buffer with an attribute
+ * divisor of 1
+ */
+struct Instance {
+  glm::mat4 model;
+  glm::vec4 colour;
+};
+
+/**
+ * Consecutive Instance values in a buffer, drawn by one call
+ */
+struct Instance_range {
+  GLuint buffer;
+  size_t offset;
+  GLsizei count;
+
+  /**
+   * @brief Point the instance attributes of the bound vertex array at the
+   * range
+   */
+  void apply() const;
+};
+
+#endif
@@ -0,0 +1,300 @@
+#ifndef VERTEX_LAYOUT_H
+#define VERTEX_LAYOUT_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <glm/glm.hpp>
+#include <span>
+#include <tuple>
+
+#include "VertexFormat.h"
+
+/**
+ * Vertex data as parsed, one stream of tightly packed floats per attribute.
+ * Positions and normals have 3 components, texture co-ordinates 2 and
+ * colours 4. Streams a mesh lacks are left empty.
+ */
+struct Vertex_streams {
+  std::span<const float> positions;
+  std::span<const float> normals;
+  std::span<const float> uvs;
+  std::span<const float> colours;
+};
+
+/**
+ * Maps positions into the unit cube for quantised storage, with
+ * (position - offset) * factor
+ */
+struct Position_map {
+  glm::vec3 offset = glm::vec3(0.0f);
+  glm::vec3 factor = glm::vec3(1.0f);
+};
+
+// Storage of one attribute in an interleaved vertex
+enum class Packing {
+  // Three floats
+  FLOAT3,
+  // Three normalised 16-bit unsigned integers padded to four, for
+  // positions mapped into the unit cube
+  UNORM16x4,
+  // GL_INT_2_10_10_10_REV, for unit vectors
+  SNORM10x3,
+  // Two half floats
+  HALF2,
+  // Four normalised bytes, for colours
+  UNORM8x4,
+};
+
+/**
+ * @brief Round a float to the nearest half float, ties to even
+ */
+inline uint16_t float_to_half(float value)
+{
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  uint16_t sign = (bits >> 16) & 0x8000;
+  uint32_t magnitude = bits & 0x7FFFFFFF;
+
+  // Infinity and NaN keep their class, values past 65504 overflow
+  if (magnitude >= 0x7F800000) {
+    return sign | 0x7C00 | (magnitude > 0x7F800000 ? 0x200 : 0);
+  }
+  if (magnitude >= 0x477FF000) {
+    return sign | 0x7C00;
+  }
+
+  // Below 2^-14 halves are subnormal, in steps of 2^-24
+  if (magnitude < 0x38800000) {
+    float steps = std::fabs(value) * 0x1p24f;
+    return sign | static_cast<uint16_t>(std::nearbyint(steps));
+  }
+
+  // Rebias the exponent and round off 13 mantissa bits, a carry moves into
+  // the exponent as it should
+  uint32_t half = (magnitude - 0x38000000) >> 13;
+  uint32_t rest = magnitude & 0x1FFF;
+  if (rest > 0x1000 || (rest == 0x1000 && (half & 1))) {
+    ++half;
+  }
+  return sign | static_cast<uint16_t>(half);
+}
+
+/**
+ * GL description and packing of each storage type. pack() reads the
+ * attribute's source components and writes SIZE bytes.
+ */
+template <Packing P> struct Packing_traits;
+
+template <> struct Packing_traits<Packing::FLOAT3> {
+  static constexpr GLint COMPONENTS = 3;
+  static constexpr GLenum TYPE = GL_FLOAT;
+  static constexpr GLboolean NORMALIZED = GL_FALSE;
+  static constexpr GLsizei SIZE = 3 * sizeof(float);
+
+  static void pack(const float *in, std::byte *out)
+  {
+    std::memcpy(out, in, SIZE);
+  }
+};
+
+template <> struct Packing_traits<Packing::UNORM16x4> {
+  static constexpr GLint COMPONENTS = 3;
+  static constexpr GLenum TYPE = GL_UNSIGNED_SHORT;
+  static constexpr GLboolean NORMALIZED = GL_TRUE;
+  static constexpr GLsizei SIZE = 4 * sizeof(uint16_t);
+
+  static void pack(const float *in, std::byte *out)
+  {
+    uint16_t packed[4] = {0, 0, 0, 0};
+    for (int k = 0; k < 3; ++k) {
+      packed[k] = static_cast<uint16_t>(
+        std::lround(std::clamp(in[k], 0.0f, 1.0f) * 65535.0f)
+      );
+    }
+    std::memcpy(out, packed, SIZE);
+  }
+};
+
+template <> struct Packing_traits<Packing::SNORM10x3> {
+  static constexpr GLint COMPONENTS = 4;
+  static constexpr GLenum TYPE = GL_INT_2_10_10_10_REV;
+  static constexpr GLboolean NORMALIZED = GL_TRUE;
+  static constexpr GLsizei SIZE = sizeof(uint32_t);
+
+  // Normalised first, so files with unnormalised normals still shade
+  // right. The 2-bit w is left at 0.
+  static void pack(const float *in, std::byte *out)
+  {
+    glm::vec3 v(in[0], in[1], in[2]);
+    float length = glm::length(v);
+    if (length > 0.0f) {
+      v /= length;
+    }
+
+    uint32_t packed = 0;
+    for (int k = 0; k < 3; ++k) {
+      long value = std::lround(std::clamp(v[k], -1.0f, 1.0f) * 511.0f);
+      packed |= (static_cast<uint32_t>(value) & 0x3FF) << (10 * k);
+    }
+    std::memcpy(out, &packed, SIZE);
+  }
+};
+
+template <> struct Packing_traits<Packing::HALF2> {
+  static constexpr GLint COMPONENTS = 2;
+  static constexpr GLenum TYPE = GL_HALF_FLOAT;
+  static constexpr GLboolean NORMALIZED = GL_FALSE;
+  static constexpr GLsizei SIZE = 2 * sizeof(uint16_t);
+
+  static void pack(const float *in, std::byte *out)
+  {
+    uint16_t packed[2] = {float_to_half(in[0]), float_to_half(in[1])};
+    std::memcpy(out, packed, SIZE);
+  }
+};
+
+template <> struct Packing_traits<Packing::UNORM8x4> {
+  static constexpr GLint COMPONENTS = 4;
+  static constexpr GLenum TYPE = GL_UNSIGNED_BYTE;
+  static constexpr GLboolean NORMALIZED = GL_TRUE;
+  static constexpr GLsizei SIZE = 4;
+
+  static void pack(const float *in, std::byte *out)
+  {
+    uint8_t packed[4];
+    for (int k = 0; k < 4; ++k) {
+      packed[k] = static_cast<uint8_t>(
+        std::lround(std::clamp(in[k], 0.0f, 1.0f) * 255.0f)
+      );
+    }
+    std::memcpy(out, packed, SIZE);
+  }
+};
+
+/**
+ * Source stream of each shader location and its components per vertex
+ */
+template <Vertex_location L> struct Location_traits;
+
+template <> struct Location_traits<POSITION> {
+  static constexpr size_t INPUTS = 3;
+  static std::span<const float> stream(const Vertex_streams &streams)
+  {
+    return streams.positions;
+  }
+};
+
+template <> struct Location_traits<NORMAL> {
+  static constexpr size_t INPUTS = 3;
+  static std::span<const float> stream(const Vertex_streams &streams)
+  {
+    return streams.normals;
+  }
+};
+
+template <> struct Location_traits<TEXCOORD> {
+  static constexpr size_t INPUTS = 2;
+  static std::span<const float> stream(const Vertex_streams &streams)
+  {
+    return streams.uvs;
+  }
+};
+
+template <> struct Location_traits<COLOUR> {
+  static constexpr size_t INPUTS = 4;
+  static std::span<const float> stream(const Vertex_streams &streams)
+  {
+    return streams.colours;
+  }
+};
+
+/**
+ * A shader location fed from its stream in one storage type
+ */
+template <Vertex_location L, Packing P> struct Attribute {
+  using Traits = Packing_traits<P>;
+  static constexpr Vertex_location LOCATION = L;
+  static constexpr GLsizei SIZE = Traits::SIZE;
+
+  static Vertex_attribute describe(GLsizei offset)
+  {
+    return {L, Traits::COMPONENTS, Traits::TYPE, Traits::NORMALIZED, offset};
+  }
+
+  // Pack one vertex, quantised positions are mapped into the unit cube
+  // first
+  static void pack(
+    const Vertex_streams &streams,
+    const Position_map &map,
+    size_t vertex,
+    std::byte *out
+  )
+  {
+    constexpr size_t INPUTS = Location_traits<L>::INPUTS;
+    const float *in = &Location_traits<L>::stream(streams)[INPUTS * vertex];
+    if constexpr (L == POSITION && Traits::NORMALIZED) {
+      float mapped[3];
+      for (int k = 0; k < 3; ++k) {
+        mapped[k] = (in[k] - map.offset[k]) * map.factor[k];
+      }
+      Traits::pack(mapped, out);
+    }
+    else {
+      Traits::pack(in, out);
+    }
+  }
+};
+
+/**
+ * Interleaved vertex made of a list of attributes, laid out in order with
+ * no padding. Every storage type is a multiple of 4 bytes, so attributes
+ * stay aligned.
+ */
+template <typename... Attributes> struct Vertex_layout {
+  static constexpr GLsizei STRIDE = (0 + ... + Attributes::SIZE);
+
+  static_assert(sizeof...(Attributes) <= Vertex_format::MAX_ATTRIBUTES);
+  static_assert(
+    std::tuple_element_t<0, std::tuple<Attributes...>>::LOCATION == POSITION,
+    "The position must come first"
+  );
+
+  /**
+   * @brief Runtime description of the layout
+   */
+  static Vertex_format format()
+  {
+    Vertex_format format;
+    format.attribute_count = 0;
+    format.stride = STRIDE;
+    GLsizei offset = 0;
+    (
+      (format.attributes[format.attribute_count++] =
+         Attributes::describe(offset),
+       offset += Attributes::SIZE),
+      ...
+    );
+    return format;
+  }
+
+  /**
+   * @brief Interleave every vertex of the streams
+   *
+   * @param out Room for STRIDE bytes per position
+   */
+  static void
+  pack(const Vertex_streams &streams, const Position_map &map, std::byte *out)
+  {
+    size_t vertex_count = streams.positions.size() / 3;
+    for (size_t i = 0; i < vertex_count; ++i) {
+      std::byte *vertex = out + i * STRIDE;
+      ((Attributes::pack(streams, map, i, vertex), vertex += Attributes::SIZE),
+       ...);
+    }
+  }
+};
+
+#endif
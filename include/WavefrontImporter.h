@@ -0,0 +1,101 @@
+#ifndef WAVEFRONT_IMPORTER_H
+#define WAVEFRONT_IMPORTER_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Streaming importer for Wavefront OBJ files. The file is read in fixed-size
+ * chunks which are parsed in parallel and merged in order, so only a bounded
+ * window of text is held in memory. Polygons are fan triangulated and each
+ * distinct v/vt/vn tuple becomes one output vertex. Texture co-ordinates
+ * and normals are output when any face uses them, with zeros for corners
+ * that leave them out.
+ */
+class Wavefront_importer
+{
+  // Face corner as written in the file
+  struct Corner {
+    // Position, texture and normal index, -1 if absent
+    int64_t index[3];
+    // Bit k set if index[k] is relative to the start of the chunk
+    uint8_t relative;
+  };
+
+  // Parsed contents of one chunk of text
+  struct Chunk {
+    std::vector<float> positions;
+    std::vector<float> texcoords;
+    std::vector<float> normals;
+    int64_t counts[3] = {0, 0, 0};
+    std::vector<Corner> corners;
+    std::vector<uint32_t> face_sizes;
+  };
+
+  struct Key_hash {
+    size_t operator()(const std::array<int64_t, 3> &key) const;
+  };
+
+  // Everything declared so far
+  std::vector<float> _positions;
+  std::vector<float> _texcoords;
+  std::vector<float> _normals;
+  int64_t _counts[3];
+  // Whether any corner used a texture or normal index
+  bool _used[3];
+  std::unordered_map<std::array<int64_t, 3>, unsigned int, Key_hash> _tuples;
+  const std::string &_path;
+
+  /**
+   * @brief Parse whole lines of text
+   */
+  Chunk parse(std::string_view text) const;
+
+  /**
+   * @brief Append a parsed chunk to the output
+   */
+  void merge(const Chunk &chunk);
+
+  /**
+   * @brief Parse a number of floats from a statement into out
+   *
+   * @param required Floats that must be present, missing ones after them
+   * read as 0
+   */
+  void read_floats(
+    const char *&cur,
+    const char *end,
+    int count,
+    int required,
+    std::vector<float> &out
+  ) const;
+
+public:
+  std::vector<float> vertices;
+  std::vector<unsigned int> indices;
+  // Per output vertex, empty if no face uses them
+  std::vector<float> uvs;
+  std::vector<float> normals;
+  // Mesh_cache::content_hash() of the text that was parsed
+  uint64_t source_hash;
+
+  /**
+   * @brief Import an OBJ file
+   *
+   * @param filepath Path of the OBJ file
+   * @param chunk_size Bytes of text read per chunk
+   */
+  Wavefront_importer(const std::string &filepath, size_t chunk_size = 4 << 20);
+
+  /**
+   * @brief Check whether a file should be read by this importer
+   */
+  static bool handles(const std::string &filepath);
+};
+
+#endif
@@ -0,0 +1,203 @@
+#include "AssetLoader.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include "MappedFile.h"
+#include "MeshCache.h"
+
+// Constructor
+Asset_loader::Asset_loader(size_t threads, size_t frame_budget) :
+  _frame_budget(frame_budget), _stopping(false), _pending(0)
+{
+  if (threads == 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  for (size_t i = 0; i < threads; ++i) {
+    this->_workers.emplace_back(&Asset_loader::work, this);
+  }
+}
+
+// Destructor
+Asset_loader::~Asset_loader()
+{
+  {
+    std::lock_guard<std::mutex> lock(this->_job_mutex);
+    this->_stopping = true;
+  }
+  this->_job_cv.notify_all();
+
+  for (std::thread &worker : this->_workers) {
+    worker.join();
+  }
+}
+
+// Queue a file for parsing
+void Asset_loader::load(
+  const std::string &filepath,
+  const std::shared_ptr<Mesh> &target,
+  const Load_options &options
+)
+{
+  this->queue({filepath, options, target, false, 0});
+}
+
+// Queue a file for parsing into a staging mesh
+void Asset_loader::reload(
+  const std::string &filepath,
+  const std::shared_ptr<Mesh> &target,
+  const Load_options &options
+)
+{
+  this->queue({filepath, options, target, true, target->source_hash()});
+}
+
+// Upload parsed meshes within the frame budget
+void Asset_loader::pump()
+{
+  // Collect meshes finished by the workers
+  {
+    std::lock_guard<std::mutex> lock(this->_parsed_mutex);
+    while (!this->_parsed.empty()) {
+      this->_uploads.push_back(std::move(this->_parsed.front()));
+      this->_parsed.pop_front();
+    }
+  }
+
+  size_t budget = this->_frame_budget;
+  while (!this->_uploads.empty() && budget > 0) {
+    Upload &upload = this->_uploads.front();
+
+    // Failed parses leave their mesh empty, or as it was for reloads. A
+    // load overtaken by a reload of the same mesh is dropped.
+    std::shared_ptr<Mesh> target = upload.target.lock();
+    bool stale = !upload.staging && upload.uploaded == 0 && target &&
+                 target->ready();
+    if (!target || !upload.spec || stale) {
+      if (target && !upload.error.empty()) {
+        std::cerr << upload.error << '\n';
+      }
+      this->_uploads.pop_front();
+      --this->_pending;
+      continue;
+    }
+
+    // Swap reloaded meshes in between frames once fully uploaded
+    Mesh &mesh = upload.staging ? *upload.staging : *target;
+    budget -= Asset_loader::stream(upload, mesh, budget);
+    if (mesh.ready()) {
+      mesh._source_hash = upload.source_hash;
+      if (upload.staging) {
+        target->swap(*upload.staging);
+      }
+      this->_uploads.pop_front();
+      --this->_pending;
+    }
+  }
+}
+
+// -------- Private Functions -------- //
+void Asset_loader::queue(Job job)
+{
+  {
+    std::lock_guard<std::mutex> lock(this->_job_mutex);
+    this->_jobs.push_back(std::move(job));
+  }
+  this->_job_cv.notify_one();
+  ++this->_pending;
+}
+
+// Parse files from the job queue
+void Asset_loader::work()
+{
+  while (true) {
+    Job job;
+    {
+      std::unique_lock<std::mutex> lock(this->_job_mutex);
+      this->_job_cv.wait(lock, [this] {
+        return this->_stopping || !this->_jobs.empty();
+      });
+      if (this->_stopping) {
+        return;
+      }
+      job = std::move(this->_jobs.front());
+      this->_jobs.pop_front();
+    }
+
+    // Meshes released before their turn are not parsed. A reload hashes
+    // the changed file here rather than on the render thread, and skips
+    // contents that did not change. Other loads take the hash from the
+    // cache or the parse, so a warm start never reads the source.
+    Upload upload{std::move(job.target), nullptr, nullptr, "", 0, 0};
+    if (!upload.target.expired()) {
+      try {
+        if (job.replace &&
+            Mesh_cache::content_hash(Mapped_file(job.filepath).view()) ==
+              job.source_hash) {
+          upload.source_hash = job.source_hash;
+          std::lock_guard<std::mutex> lock(this->_parsed_mutex);
+          this->_parsed.push_back(std::move(upload));
+          continue;
+        }
+        upload.spec =
+          std::make_unique<Object::Obj_spec>(job.filepath, job.options);
+        upload.source_hash = upload.spec->source_hash;
+        if (job.replace) {
+          upload.staging = std::make_unique<Mesh>();
+        }
+      } catch (const std::exception &err) {
+        upload.error = err.what();
+        if (job.replace) {
+          upload.error += "\nKeeping the previous version of " + job.filepath;
+        }
+      }
+    }
+
+    std::lock_guard<std::mutex> lock(this->_parsed_mutex);
+    this->_parsed.push_back(std::move(upload));
+  }
+}
+
+// Upload the next part of a mesh, vertices first and then indices
+size_t Asset_loader::stream(Upload &upload, Mesh &target, size_t budget)
+{
+  std::span<const std::byte> vertices = upload.spec->vertex_bytes();
+  std::span<const std::byte> indices = upload.spec->index_bytes();
+
+  if (upload.uploaded == 0) {
+    target.create_buffers(
+      vertices.size(),
+      indices.size(),
+      upload.spec->index_type,
+      upload.spec->format
+    );
+  }
+
+  size_t start = upload.uploaded;
+  size_t total = vertices.size() + indices.size();
+  size_t end = start + std::min(budget, total - start);
+
+  // Part of the range that falls in the vertex buffer
+  if (start < vertices.size()) {
+    size_t stop = std::min(end, vertices.size());
+    target.fill_buffer(
+      GL_ARRAY_BUFFER, start, vertices.subspan(start, stop - start)
+    );
+  }
+
+  // Part of the range that falls in the index buffer
+  if (end > vertices.size()) {
+    size_t first = std::max(start, vertices.size()) - vertices.size();
+    size_t stop = end - vertices.size();
+    target.fill_buffer(
+      GL_ELEMENT_ARRAY_BUFFER, first, indices.subspan(first, stop - first)
+    );
+  }
+
+  upload.uploaded = end;
+  if (end == total) {
+    target.finish_load(upload.spec->colour, upload.spec->lod_data());
+  }
+
+  return end - start;
+}
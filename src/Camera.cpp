@@ -29,6 +29,28 @@ glm::mat4 Camera::view()
   return glm::lookAt(this->_pos, this->_pos + this->_front, this->_up);
 }
 
+// Combine the matrices and extract the frustum planes from their product
+Camera::Uniforms Camera::uniforms(const glm::mat4 &projection)
+{
+  Uniforms block;
+  block.view = this->view();
+  block.projection = projection;
+  block.view_projection = projection * block.view;
+  block.position = glm::vec4(this->_pos, 1.0f);
+
+  // Each plane is the last row of the matrix plus or minus another row
+  const glm::mat4 &m = block.view_projection;
+  glm::vec4 rows[4];
+  for (int i = 0; i < 4; ++i) {
+    rows[i] = glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+  }
+  for (int i = 0; i < 6; ++i) {
+    glm::vec4 plane = i % 2 ? rows[3] - rows[i / 2] : rows[3] + rows[i / 2];
+    block.frustum[i] = plane / glm::length(glm::vec3(plane));
+  }
+  return block;
+}
+
 void Camera::move(Cam_dir dir, float dt)
 {
   if (dir == FORWARD) {
@@ -0,0 +1,200 @@
+#include "DynamicMesh.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "GeometryArena.h"
+#include "GlExtensions.h"
+#include "GpuMemory.h"
+
+namespace {
+  // Block until the GPU has passed a fence, then delete it
+  void wait(GLsync &fence)
+  {
+    if (!fence) {
+      return;
+    }
+    while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) ==
+           GL_TIMEOUT_EXPIRED) {
+    }
+    glDeleteSync(fence);
+    fence = nullptr;
+  }
+}  // namespace
+
+// Constructor
+Dynamic_mesh::Dynamic_mesh(
+  std::span<const std::byte> vertices,
+  std::span<const std::byte> indices,
+  GLenum type,
+  const Vertex_format &format,
+  glm::vec3 colour
+) :
+  _vao(0),
+  _vbo(0),
+  _ebo(0),
+  _copy_bytes(vertices.size()),
+  _mapped(nullptr),
+  _vertices(vertices.begin(), vertices.end()),
+  _copies{},
+  _current(0)
+{
+  if (vertices.empty() || vertices.size() % format.stride != 0) {
+    throw std::runtime_error("Dynamic mesh needs a whole number of vertices");
+  }
+  this->index_count = indices.size() / Mesh::index_size(type);
+  this->index_type = type;
+  this->vertex_count = vertices.size() / format.stride;
+  this->_format = format;
+
+  glGenVertexArrays(1, &(this->_vao));
+  Geometry_arena::shared().bind_vertex_array(this->_vao);
+
+  // Indices never change
+  glGenBuffers(1, &(this->_ebo));
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->_ebo);
+  glBufferData(
+    GL_ELEMENT_ARRAY_BUFFER, indices.size(), indices.data(), GL_STATIC_DRAW
+  );
+  Gpu_memory::shared().allocate(Gpu_memory::INDEX, indices.size());
+
+  // Map every copy once and keep it mapped
+  size_t size = COPIES * this->_copy_bytes;
+  glGenBuffers(1, &(this->_vbo));
+  glBindBuffer(GL_ARRAY_BUFFER, this->_vbo);
+  if (Gl_extensions::buffer_storage) {
+    GLbitfield flags =
+      GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    Gl_extensions::BufferStorage(GL_ARRAY_BUFFER, size, nullptr, flags);
+    this->_mapped = static_cast<std::byte *>(
+      glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags)
+    );
+
+    // Immutable storage cannot be respecified with glBufferData
+    if (!this->_mapped) {
+      glDeleteBuffers(1, &(this->_vbo));
+      glGenBuffers(1, &(this->_vbo));
+      glBindBuffer(GL_ARRAY_BUFFER, this->_vbo);
+    }
+  }
+  if (!this->_mapped) {
+    glBufferData(GL_ARRAY_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+  }
+  Gpu_memory::shared().allocate(Gpu_memory::DYNAMIC, size);
+  for (size_t copy = 0; copy < COPIES; ++copy) {
+    this->upload(copy, 0, this->_copy_bytes);
+  }
+
+  format.apply();
+
+  this->finish_load(colour);
+}
+
+// Destructor
+Dynamic_mesh::~Dynamic_mesh()
+{
+  for (Copy &copy : this->_copies) {
+    if (copy.fence) {
+      glDeleteSync(copy.fence);
+    }
+  }
+  if (this->_mapped) {
+    glBindBuffer(GL_COPY_WRITE_BUFFER, this->_vbo);
+    glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+  }
+  glDeleteBuffers(1, &(this->_vbo));
+  glDeleteBuffers(1, &(this->_ebo));
+  Geometry_arena::shared().forget_vertex_array(this->_vao);
+  glDeleteVertexArrays(1, &(this->_vao));
+
+  Gpu_memory &memory = Gpu_memory::shared();
+  memory.release(Gpu_memory::DYNAMIC, COPIES * this->_copy_bytes);
+  memory.release(
+    Gpu_memory::INDEX, this->index_count * Mesh::index_size(this->index_type)
+  );
+}
+
+// Update the CPU copy, the GPU copies catch up as they become current
+void Dynamic_mesh::write(size_t offset, std::span<const std::byte> bytes)
+{
+  std::span<std::byte> target = this->edit(offset, bytes.size());
+  std::memcpy(target.data(), bytes.data(), bytes.size());
+}
+
+std::span<std::byte> Dynamic_mesh::edit(size_t offset, size_t bytes)
+{
+  if (offset > this->_copy_bytes || bytes > this->_copy_bytes - offset) {
+    throw std::runtime_error("Dynamic mesh write out of bounds");
+  }
+  this->mark(offset, offset + bytes);
+  return std::span(this->_vertices).subspan(offset, bytes);
+}
+
+// Fence the copy drawn so far and bring the next one up to date
+void Dynamic_mesh::flush()
+{
+  Copy &drawn = this->_copies[this->_current];
+  if (drawn.dirty_begin >= drawn.dirty_end) {
+    return;
+  }
+  drawn.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+  // Frames in flight finished with the next copy long ago, unless flushed
+  // more than once per frame
+  this->_current = (this->_current + 1) % COPIES;
+  Copy &next = this->_copies[this->_current];
+  wait(next.fence);
+  this->upload(this->_current, next.dirty_begin, next.dirty_end);
+  next.dirty_begin = next.dirty_end = 0;
+}
+
+// Draw the current copy, offset by whole copies of the vertices
+void Dynamic_mesh::draw(const Instance_range &instances, size_t lod) const
+{
+  const Mesh_lod &range = this->_lods[std::min(lod, this->_lods.size() - 1)];
+
+  Geometry_arena::shared().bind_vertex_array(this->_vao);
+  instances.apply();
+  glDrawElementsInstancedBaseVertex(
+    GL_TRIANGLES,
+    range.count,
+    this->index_type,
+    (void *)(uintptr_t)(range.first * Mesh::index_size(this->index_type)),
+    instances.count,
+    static_cast<GLint>(this->_current * this->vertex_count)
+  );
+}
+
+// -------- Private Functions -------- //
+void Dynamic_mesh::mark(size_t begin, size_t end)
+{
+  for (Copy &copy : this->_copies) {
+    if (copy.dirty_begin >= copy.dirty_end) {
+      copy.dirty_begin = begin;
+      copy.dirty_end = end;
+    }
+    else {
+      copy.dirty_begin = std::min(copy.dirty_begin, begin);
+      copy.dirty_end = std::max(copy.dirty_end, end);
+    }
+  }
+}
+
+void Dynamic_mesh::upload(size_t copy, size_t begin, size_t end)
+{
+  if (begin >= end) {
+    return;
+  }
+  size_t offset = copy * this->_copy_bytes + begin;
+  if (this->_mapped) {
+    std::memcpy(
+      this->_mapped + offset, this->_vertices.data() + begin, end - begin
+    );
+    return;
+  }
+  glBindBuffer(GL_COPY_WRITE_BUFFER, this->_vbo);
+  glBufferSubData(
+    GL_COPY_WRITE_BUFFER, offset, end - begin, this->_vertices.data() + begin
+  );
+}
@@ -0,0 +1,110 @@
+#include "FileWatcher.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace {
+  // Events that leave a file with new contents
+  constexpr uint32_t EVENTS = IN_CLOSE_WRITE | IN_MOVED_TO;
+}  // namespace
+
+// Constructor
+File_watcher::File_watcher() :
+  _inotify(inotify_init1(IN_NONBLOCK | IN_CLOEXEC)),
+  _wake(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+{
+  if (this->_inotify < 0 || this->_wake < 0) {
+    std::cerr << "Cannot start file watcher: " << std::strerror(errno)
+              << '\n';
+    return;
+  }
+  this->_thread = std::thread(&File_watcher::work, this);
+}
+
+// Destructor
+File_watcher::~File_watcher()
+{
+  if (this->_thread.joinable()) {
+    uint64_t one = 1;
+    if (write(this->_wake, &one, sizeof(one)) == sizeof(one)) {
+      this->_thread.join();
+    }
+    else {
+      this->_thread.detach();
+    }
+  }
+  if (this->_inotify >= 0) {
+    close(this->_inotify);
+  }
+  if (this->_wake >= 0) {
+    close(this->_wake);
+  }
+}
+
+// Add a directory watch
+bool File_watcher::watch(const std::string &dir)
+{
+  if (this->_inotify < 0) {
+    return false;
+  }
+
+  int wd = inotify_add_watch(this->_inotify, dir.c_str(), EVENTS);
+  if (wd < 0) {
+    std::cerr << "Cannot watch " << dir << ": " << std::strerror(errno)
+              << '\n';
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(this->_mutex);
+  this->_dirs[wd] = dir;
+  return true;
+}
+
+// Drain the changed files
+std::vector<std::string> File_watcher::changes()
+{
+  std::lock_guard<std::mutex> lock(this->_mutex);
+  std::vector<std::string> paths(this->_changed.begin(), this->_changed.end());
+  this->_changed.clear();
+  return paths;
+}
+
+// -------- Private Functions -------- //
+// Wait for inotify events or the wake-up from the destructor
+void File_watcher::work()
+{
+  alignas(inotify_event) char buffer[4096];
+  pollfd fds[2] = {{this->_inotify, POLLIN, 0}, {this->_wake, POLLIN, 0}};
+
+  while (true) {
+    if (poll(fds, 2, -1) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      std::cerr << "File watcher stopped: " << std::strerror(errno) << '\n';
+      return;
+    }
+    if (fds[1].revents) {
+      return;
+    }
+
+    ssize_t length;
+    while ((length = read(this->_inotify, buffer, sizeof(buffer))) > 0) {
+      std::lock_guard<std::mutex> lock(this->_mutex);
+      for (ssize_t i = 0; i < length;) {
+        const auto *event = reinterpret_cast<const inotify_event *>(buffer + i);
+        auto dir = this->_dirs.find(event->wd);
+        if (event->len > 0 && dir != this->_dirs.end()) {
+          this->_changed.insert(dir->second + "/" + event->name);
+        }
+        i += sizeof(inotify_event) + event->len;
+      }
+    }
+  }
+}
@@ -1,22 +1,74 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
 #include <iostream>
+#include <tuple>
 
 #include "GLApp.h"
+#include "GlbLoader.h"
 
 #include <glm/glm.hpp>
 
+namespace {
+  // Directories watched for edits while the app runs
+  const std::string OBJECT_DIR = "./data/objects";
+  const std::string SHADER_DIR = "./src/shaders";
+
+  const std::string VERT_SHADER = SHADER_DIR + "/shader.vert";
+  const std::string FRAG_SHADER = SHADER_DIR + "/shader.frag";
+
+  // Linked program binaries kept between runs
+  const std::string PROGRAM_CACHE_DIR = "./cache/shaders";
+
+  // Vertical field of view and depth range
+  const float FOV = glm::radians(90.0f);
+  constexpr float NEAR_PLANE = 0.1f;
+  constexpr float FAR_PLANE = 100.0f;
+
+  // Uniform block binding point of per-mesh data, the camera block is bound
+  // by every Shader
+  constexpr GLuint MESH_BLOCK = 1;
+
+  // Storage block binding point of the per-draw mesh values of multi-draw
+  // calls, fixed in the vertex shader
+  constexpr GLuint MESH_STORAGE = 2;
+
+  // Unlit and rescaling positions, which draws any mesh correctly while
+  // other variants compile
+  constexpr uint32_t FALLBACK_FEATURES = Shader_library::QUANTIZED;
+}  // namespace
+
 // Constructor
 GLApp::GLApp(int width, int height, const char *title) :
   _width(width),
   _height(height),
+  _projection(glm::mat4(1.0f)),
   _title(title),
   _window(nullptr),
-  _shader(nullptr)
+  _shaders(nullptr),
+  _lighting(true),
+  _programs(nullptr),
+  _uniforms(nullptr),
+  _instances(nullptr),
+  _commands(nullptr),
+  _mesh_values(nullptr),
+  _stats{},
+  _lod_error(1.0f),
+  _budget(_loader)
 {}
 
 // Destructor
 GLApp::~GLApp()
 {
-  delete this->_shader;
+  // Meshes owning GL objects go while the context is current
+  this->_objects.clear();
+  delete this->_shaders;
+  delete this->_programs;
+  delete this->_uniforms;
+  delete this->_instances;
+  delete this->_commands;
+  delete this->_mesh_values;
+  Geometry_arena::shared().clear();
   glfwTerminate();
 }
 
@@ -50,6 +102,7 @@ bool GLApp::init()
   // Keyboard callback
   glfwSetKeyCallback(this->_window, key_callback);
   glfwSetWindowUserPointer(this->_window, this);
+  this->update_projection();
   // Mouse callback
   glfwSetCursorPosCallback(this->_window, Camera::mouse_callback);
   glfwSetInputMode(this->_window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
@@ -59,23 +112,86 @@ bool GLApp::init()
     std::cerr << "Failed to initialize GLAD\n";
     return false;
   }
+  Gl_extensions::load((GLADloadproc)glfwGetProcAddress);
+
+  // Meshes without vertex colours read white, leaving the object colour
+  glVertexAttrib4f(COLOUR, 1.0f, 1.0f, 1.0f, 1.0f);
+
+  // Opaque objects are drawn front to back so hidden fragments fail the
+  // depth test early, transparent ones are blended over them
+  glEnable(GL_DEPTH_TEST);
+  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+  // Ring buffers for per-frame uniforms and instance attributes
+  this->_uniforms = new Stream_buffer(GL_UNIFORM_BUFFER, 64 << 10);
+  this->_instances = new Stream_buffer(GL_ARRAY_BUFFER, 256 << 10);
+  if (Gl_extensions::multi_draw_indirect) {
+    this->_commands = new Stream_buffer(GL_DRAW_INDIRECT_BUFFER, 16 << 10);
+    this->_mesh_values = new Stream_buffer(GL_SHADER_STORAGE_BUFFER, 32 << 10);
+  }
 
-  // Setup shaders
+  // Setup shaders, from cached binaries when the driver supports them. Only
+  // the fallback is built here, other variants compile when first drawn.
+  this->_programs = new Program_cache(PROGRAM_CACHE_DIR);
+  auto start = std::chrono::steady_clock::now();
   try {
-    this->_shader =
-      new Shader("./src/shaders/shader.vert", "./src/shaders/shader.frag");
+    this->_shaders = new Shader_library(
+      VERT_SHADER,
+      FRAG_SHADER,
+      this->_programs,
+      GLApp::bind_blocks,
+      FALLBACK_FEATURES
+    );
   } catch (const std::exception &err) {
     std::cerr << err.what() << "\n";
     return false;
   }
+  std::chrono::duration<double, std::milli> elapsed =
+    std::chrono::steady_clock::now() - start;
+  std::cout << "Shaders ready in " << elapsed.count() << " ms"
+            << (this->_shaders->fallback().cached()
+                  ? " from cached binary\n"
+                  : ", compiled from source\n");
+
+  // Pick up edits to meshes and shaders
+  this->_watcher.watch(OBJECT_DIR);
+  this->_watcher.watch(SHADER_DIR);
 
   return true;
 }
 
-void GLApp::add_object(const std::string &filepath)
+Object_handle
+GLApp::add_object(const std::string &filepath, const Load_options &options)
+{
+  bool created;
+  std::shared_ptr<Mesh> mesh =
+    this->_meshes.acquire(filepath, options, created);
+  if (created) {
+    this->_loader.load(filepath, mesh, options);
+    this->_budget.track(mesh, filepath, options);
+  }
+
+  return this->_objects.create(std::move(mesh));
+}
+
+Object_handle GLApp::add_object(std::shared_ptr<Mesh> mesh)
 {
-  Object *obj = new Object(filepath);
-  this->_objects.push_back(obj);
+  return this->_objects.create(std::move(mesh));
+}
+
+bool GLApp::remove_object(Object_handle handle)
+{
+  return this->_objects.destroy(handle);
+}
+
+std::vector<Object_handle> GLApp::add_scene(const std::string &filepath)
+{
+  std::vector<Object_handle> handles;
+  for (Object &obj : Glb_loader(filepath).create_objects()) {
+    this->_budget.track(obj.mesh());
+    handles.push_back(this->_objects.create(std::move(obj)));
+  }
+  return handles;
 }
 
 // Main render loop
@@ -93,53 +209,352 @@ void GLApp::run()
     this->dt = cur_time - last_time;
     last_time = cur_time;
 
+    // Swap in edited files and upload meshes finished by the loader
+    this->hot_reload();
+    this->_loader.pump();
+    Geometry_arena::shared().defragment();
+
     // Transform Objects here
-    this->_objects[0]->rotate(glm::vec3(1.0, 0.0, 0.7), 50 * dt);
+    if (!this->_objects.empty()) {
+      this->_objects[0].rotate(glm::vec3(1.0, 0.0, 0.7), 50 * dt);
+    }
 
-    // Render objects
+    // Render objects, then evict what the frame did not need if over budget
     this->render();
+    this->_budget.enforce();
 
     // Swap buffers and register events
     glfwSwapBuffers(this->_window);
     glfwPollEvents();
   }
-
-  // Free memory used by objects
-  this->clear_objects();
 }
 
 // -------- Private Functions -------- //
+// Queue changed meshes and rebuild the shader programs
+void GLApp::hot_reload()
+{
+  bool shaders = false;
+  for (const std::string &path : this->_watcher.changes()) {
+    if (path.starts_with(SHADER_DIR + "/")) {
+      shaders = true;
+      continue;
+    }
+    for (const auto &stale : this->_meshes.changed(path)) {
+      std::cout << "Reloading " << path << "\n";
+      this->_loader.reload(path, stale.mesh, stale.options);
+    }
+  }
+
+  // Shaders rebuild in the background and are swapped in once ready.
+  // Errors leave the previous programs in use.
+  try {
+    if (shaders) {
+      this->_shaders->reload();
+    }
+    if (this->_shaders->finish_reload()) {
+      std::cout << "Reloaded shaders\n";
+    }
+  } catch (const std::exception &err) {
+    std::cerr << err.what() << "\nKeeping the previous shaders\n";
+  }
+}
+
 // Render objects to screen
 void GLApp::render()
 {
   glClearColor(0.36F, 0.82F, 0.98F, 1.0F);
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-  this->_shader->use();
-  // Set up perspective projection for 3D rendering
-  glm::mat4 proj = glm::perspective(
-    glm::radians(90.0f),
-    (float)this->_width / (float)this->_height,
-    0.1f,
-    100.0f
+  Camera::Uniforms camera = this->_cam.uniforms(this->_projection);
+  Geometry_arena &arena = Geometry_arena::shared();
+  size_t vertex_array_binds = arena.vertex_array_binds();
+  this->_stats = {};
+
+  // Queue ready objects at the cheapest level of detail that is accurate to
+  // within the pixel error, keyed by the state they are drawn with
+  glm::vec3 eye = this->_cam.position();
+  float projection = this->_height / (2.0f * std::tan(FOV / 2.0f));
+  this->_draws.clear();
+  this->_queue.clear();
+  for (Object &obj : this->_objects) {
+    this->_budget.use(obj.mesh());
+    if (obj.ready()) {
+      size_t lod = obj.lod(eye, projection, this->_lod_error);
+      uint32_t features = this->features(obj);
+      bool transparent = obj.opacity() < 1.0f;
+      float depth = glm::length(obj.position() - eye) / FAR_PLANE;
+      uint64_t key = Render_queue::key(
+        transparent ? Render_queue::TRANSPARENT : Render_queue::OPAQUE,
+        features,
+        obj.mesh()->id(),
+        lod,
+        depth
+      );
+      this->_queue.push(key, this->_draws.size());
+      this->_draws.push_back({&obj, lod, features, transparent});
+    }
+  }
+  this->_queue.sort();
+
+  // Write the frame's instances in key order before any draw reads them,
+  // batching runs of draws that share all of their state
+  Stream_buffer &instances = *(this->_instances);
+  instances.begin_frame(
+    this->_draws.size() * instances.aligned(sizeof(Instance))
+  );
+  size_t first_instance = 0;
+  this->_batches.clear();
+  for (const Render_queue::Item &item : this->_queue.items()) {
+    const Draw &draw = this->_draws[item.payload];
+    const Mesh *mesh = draw.object->mesh().get();
+    size_t offset = instances.write(draw.object->instance());
+    if (this->_batches.empty()) {
+      first_instance = offset;
+    }
+    else {
+      Batch &last = this->_batches.back();
+      if (last.mesh == mesh && last.lod == draw.lod &&
+          last.features == draw.features &&
+          last.transparent == draw.transparent) {
+        ++last.count;
+        continue;
+      }
+    }
+    this->_batches.push_back(
+      {mesh, draw.lod, draw.features, 0, offset, 1, draw.transparent, false}
+    );
+  }
+  if (this->_commands) {
+    this->write_multi_draws(first_instance);
+  }
+
+  // Uniforms of the camera and of each mesh left to draw on its own, shared
+  // by adjacent batches of one mesh
+  Stream_buffer &uniforms = *(this->_uniforms);
+  uniforms.begin_frame(
+    uniforms.aligned(sizeof(Camera::Uniforms)) +
+    this->_batches.size() * uniforms.aligned(sizeof(Mesh::Uniforms))
   );
-  glm::mat4 view = this->_cam.view();
+  size_t camera_offset = uniforms.write(camera);
+  const Batch *previous = nullptr;
+  for (Batch &batch : this->_batches) {
+    if (batch.indirect) {
+      continue;
+    }
+    batch.uniform_offset = previous && previous->mesh == batch.mesh
+                             ? previous->uniform_offset
+                             : uniforms.write(batch.mesh->uniforms());
+    previous = &batch;
+  }
+  uniforms.flush();
+  instances.flush();
 
-  this->_shader->set_mat4("projection", proj);
-  this->_shader->set_mat4("view", view);
+  uniforms.bind(Shader::CAMERA_BLOCK, camera_offset, sizeof(camera));
+  ++this->_stats.buffers;
+  const Shader *current = nullptr;
 
-  // Draw objects
-  for (Object *obj : this->_objects) {
-    obj->draw(*(this->_shader));
+  // One multi-draw call per variant, pool and index type, with the
+  // commands' base instances counted from the frame's first instance
+  if (!this->_multi_draws.empty()) {
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, this->_commands->buffer());
+    ++this->_stats.buffers;
+  }
+  Instance_range frame_instances{
+    instances.buffer(), first_instance, GLsizei(this->_draws.size())
+  };
+  for (const Multi_draw &multi : this->_multi_draws) {
+    Shader &shader = this->_shaders->get(multi.features);
+    if (&shader != current) {
+      shader.use();
+      current = &shader;
+      ++this->_stats.programs;
+    }
+    this->_mesh_values->bind(
+      MESH_STORAGE, multi.mesh_offset, multi.count * sizeof(Mesh::Uniforms)
+    );
+    ++this->_stats.buffers;
+    arena.multi_draw(
+      multi.pool, multi.type, multi.command_offset, multi.count, frame_instances
+    );
+    ++this->_stats.draws;
   }
+
+  // One instanced draw per remaining batch in key order, setting only the
+  // state that differs from the previous batch. Transparent batches come
+  // last and are blended without writing depth.
+  size_t bound_uniforms = SIZE_MAX;
+  bool blending = false;
+  for (const Batch &batch : this->_batches) {
+    if (batch.indirect) {
+      continue;
+    }
+    if (batch.transparent && !blending) {
+      glEnable(GL_BLEND);
+      glDepthMask(GL_FALSE);
+      blending = true;
+      ++this->_stats.blend_states;
+    }
+    Shader &shader = this->_shaders->get(batch.features);
+    if (&shader != current) {
+      shader.use();
+      current = &shader;
+      ++this->_stats.programs;
+    }
+    if (batch.uniform_offset != bound_uniforms) {
+      uniforms.bind(MESH_BLOCK, batch.uniform_offset, sizeof(Mesh::Uniforms));
+      bound_uniforms = batch.uniform_offset;
+      ++this->_stats.buffers;
+    }
+    batch.mesh->draw(
+      {instances.buffer(), batch.instance_offset, batch.count}, batch.lod
+    );
+    ++this->_stats.draws;
+  }
+  if (blending) {
+    glDisable(GL_BLEND);
+    glDepthMask(GL_TRUE);
+    ++this->_stats.blend_states;
+  }
+  this->_stats.vertex_arrays = arena.vertex_array_binds() - vertex_array_binds;
+
+  uniforms.end_frame();
+  instances.end_frame();
+  if (this->_commands) {
+    this->_commands->end_frame();
+    this->_mesh_values->end_frame();
+  }
+}
+
+// Group commands so each call draws from one vertex array with one index
+// type, keeping the mesh order within a group
+void GLApp::write_multi_draws(size_t instance_offset)
+{
+  this->_indirect.clear();
+  for (Batch &batch : this->_batches) {
+    // Blended batches keep their back to front order, which grouping would
+    // break
+    uint32_t features = batch.features | Shader_library::MULTI_DRAW;
+    if (batch.transparent ||
+        &(this->_shaders->get(features)) == &(this->_shaders->fallback())) {
+      continue;
+    }
+    GLuint first = (batch.instance_offset - instance_offset) / sizeof(Instance);
+    Geometry_arena::Indirect_draw draw;
+    if (batch.mesh->indirect(draw, batch.count, first, batch.lod)) {
+      batch.features = features;
+      batch.indirect = true;
+      this->_indirect.push_back({&batch, draw});
+    }
+  }
+  std::stable_sort(
+    this->_indirect.begin(),
+    this->_indirect.end(),
+    [](const Indirect_batch &a, const Indirect_batch &b) {
+      return std::tuple(a.batch->features, a.draw.pool, a.draw.type) <
+             std::tuple(b.batch->features, b.draw.pool, b.draw.type);
+    }
+  );
+
+  // Each group's commands and mesh values are written in one piece, so only
+  // the first of them is padded to the buffer's alignment
+  Stream_buffer &commands = *(this->_commands);
+  Stream_buffer &mesh_values = *(this->_mesh_values);
+  size_t count = this->_indirect.size();
+  commands.begin_frame(
+    count * commands.aligned(sizeof(Geometry_arena::Draw_command))
+  );
+  mesh_values.begin_frame(
+    count * mesh_values.aligned(sizeof(Mesh::Uniforms))
+  );
+  this->_multi_draws.clear();
+  for (size_t begin = 0, end = 0; begin < count; begin = end) {
+    const Indirect_batch &first = this->_indirect[begin];
+    this->_command_data.clear();
+    this->_mesh_data.clear();
+    for (end = begin; end < count; ++end) {
+      const Indirect_batch &next = this->_indirect[end];
+      if (next.batch->features != first.batch->features ||
+          next.draw.pool != first.draw.pool ||
+          next.draw.type != first.draw.type) {
+        break;
+      }
+      this->_command_data.push_back(next.draw.command);
+      this->_mesh_data.push_back(next.batch->mesh->uniforms());
+    }
+
+    size_t command_offset = commands.write(
+      this->_command_data.data(),
+      this->_command_data.size() * sizeof(Geometry_arena::Draw_command)
+    );
+    size_t mesh_offset = mesh_values.write(
+      this->_mesh_data.data(), this->_mesh_data.size() * sizeof(Mesh::Uniforms)
+    );
+    this->_multi_draws.push_back(
+      {first.batch->features,
+       first.draw.pool,
+       first.draw.type,
+       command_offset,
+       mesh_offset,
+       GLsizei(end - begin)}
+    );
+  }
+  commands.flush();
+  mesh_values.flush();
+}
+
+// Shader features an object needs
+uint32_t GLApp::features(const Object &obj) const
+{
+  const Vertex_format &format = obj.mesh()->format();
+  uint32_t features = 0;
+  if (format.quantized()) {
+    features |= Shader_library::QUANTIZED;
+  }
+  if (format.find(NORMAL)) {
+    features |= Shader_library::NORMALS;
+  }
+  if (this->_lighting) {
+    features |= Shader_library::LIGHTING;
+  }
+  return features;
+}
+
+// Bind uniform blocks by name and check their size, once per program
+void GLApp::bind_blocks(Shader &shader)
+{
+  shader.bind_block("Mesh", MESH_BLOCK);
+
+  // Programs must not read past the data written for them
+  if (shader.block_size("Camera") > GLint(sizeof(Camera::Uniforms)) ||
+      shader.block_size("Mesh") > GLint(sizeof(Mesh::Uniforms))) {
+    throw std::runtime_error("Uniform blocks do not match the app's layout");
+  }
+}
+
+// Set up perspective projection for 3D rendering
+void GLApp::update_projection()
+{
+  this->_projection = glm::perspective(
+    FOV,
+    (float)this->_width / (float)std::max(this->_height, 1),
+    NEAR_PLANE,
+    FAR_PLANE
+  );
 }
 
 // Resize Callback function
 void GLApp::framebuffer_size_callback(
-  [[maybe_unused]] GLFWwindow *window, int width, int height
+  GLFWwindow *window, int width, int height
 )
 {
   glViewport(0, 0, width, height);
+
+  auto *app = static_cast<GLApp *>(glfwGetWindowUserPointer(window));
+  if (app) {
+    app->_width = width;
+    app->_height = height;
+    app->update_projection();
+  }
 }
 
 void GLApp::on_key(
@@ -150,6 +565,45 @@ void GLApp::on_key(
   if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS) {
     glfwSetWindowShouldClose(this->_window, GLFW_TRUE);
   }
+  // Report geometry arena usage
+  if (key == GLFW_KEY_G && action == GLFW_PRESS) {
+    Geometry_arena::Stats stats = Geometry_arena::shared().stats();
+    std::cout << "Geometry: " << stats.blocks << " meshes in " << stats.pools
+              << " pools, vertices " << stats.vertex_used << "/"
+              << stats.vertex_capacity << " bytes, indices "
+              << stats.index_used << "/" << stats.index_capacity
+              << " bytes, " << stats.free_ranges << " free ranges, "
+              << stats.fragmentation * 100.0f << "% fragmented\n";
+  }
+  // Report the state changes of the last frame
+  if (key == GLFW_KEY_R && action == GLFW_PRESS) {
+    const Frame_stats &stats = this->_stats;
+    std::cout << "Frame: " << this->_queue.size() << " objects in "
+              << stats.draws << " draws, "
+              << stats.programs + stats.vertex_arrays + stats.buffers +
+                   stats.blend_states
+              << " state changes (" << stats.programs << " programs, "
+              << stats.vertex_arrays << " vertex arrays, " << stats.buffers
+              << " buffer bindings, " << stats.blend_states
+              << " blend states)\n";
+  }
+  // Toggle lighting
+  if (key == GLFW_KEY_L && action == GLFW_PRESS) {
+    this->_lighting = !this->_lighting;
+  }
+  // Report GPU memory by category
+  if (key == GLFW_KEY_M && action == GLFW_PRESS) {
+    const Gpu_memory &memory = Gpu_memory::shared();
+    for (int i = 0; i < Gpu_memory::CATEGORIES; ++i) {
+      auto category = static_cast<Gpu_memory::Category>(i);
+      Gpu_memory::Usage usage = memory.usage(category);
+      std::cout << Gpu_memory::name(category) << ": " << usage.current
+                << " bytes, peak " << usage.peak << "\n";
+    }
+    std::cout << "total: " << memory.total().current << " bytes, peak "
+              << memory.total().peak << ", budget " << this->_budget.budget()
+              << "\n";
+  }
   // Camera movement
   if (key == GLFW_KEY_W) {
     this->_cam.move(FORWARD, this->dt);
@@ -179,10 +633,3 @@ void GLApp::key_callback(
     app->on_key(key, scancode, action, mods);
   }
 }
-
-void GLApp::clear_objects()
-{
-  for (Object *obj : this->_objects) {
-    delete obj;
-  }
-}
@@ -0,0 +1,432 @@
+#include "GeometryArena.h"
+
+#include <algorithm>
+
+#include "GlExtensions.h"
+
+namespace {
+  constexpr size_t WORD = 4;
+
+  size_t round_up(size_t value, size_t unit)
+  {
+    return (value + unit - 1) / unit;
+  }
+}  // namespace
+
+// Constructor
+Geometry_arena::Geometry_arena(size_t initial_bytes) :
+  _initial_bytes(initial_bytes), _bound_vao(0), _vertex_array_binds(0)
+{}
+
+// Destructor
+Geometry_arena::~Geometry_arena()
+{
+  this->clear();
+}
+
+// Arena living for the whole program
+Geometry_arena &Geometry_arena::shared()
+{
+  static Geometry_arena arena;
+  return arena;
+}
+
+// Take a block and space in the pool for the layout
+uint32_t Geometry_arena::allocate(
+  const Vertex_format &format, size_t vertex_bytes, size_t index_bytes
+)
+{
+  size_t pool_index = this->pool_for(format);
+  Pool &pool = this->_pools[pool_index];
+
+  // Empty meshes still take one unit so every block has an offset
+  Block block{pool_index, 0, 0, 0, 0, true};
+  block.vertex_count = std::max<size_t>(1, round_up(vertex_bytes, pool.stride));
+  block.word_count = std::max<size_t>(1, round_up(index_bytes, WORD));
+
+  if (!pool.vertices.allocate(block.vertex_count, block.first_vertex)) {
+    this->grow(pool, block.vertex_count, 0);
+    pool.vertices.allocate(block.vertex_count, block.first_vertex);
+  }
+  if (!pool.words.allocate(block.word_count, block.first_word)) {
+    this->grow(pool, 0, block.word_count);
+    pool.words.allocate(block.word_count, block.first_word);
+  }
+
+  // Reuse released block slots
+  if (this->_free_blocks.empty()) {
+    this->_blocks.push_back(block);
+    return this->_blocks.size() - 1;
+  }
+  uint32_t index = this->_free_blocks.back();
+  this->_free_blocks.pop_back();
+  this->_blocks[index] = block;
+  return index;
+}
+
+// Return a block's ranges to its pool
+void Geometry_arena::release(uint32_t block)
+{
+  if (block >= this->_blocks.size() || !this->_blocks[block].live) {
+    return;
+  }
+
+  Block &range = this->_blocks[block];
+  Pool &pool = this->_pools[range.pool];
+  pool.vertices.release(range.first_vertex, range.vertex_count);
+  pool.words.release(range.first_word, range.word_count);
+  range.live = false;
+  this->_free_blocks.push_back(block);
+}
+
+// Write through the copy target so no VAO state is touched
+void Geometry_arena::fill(
+  uint32_t block, GLenum target, size_t offset, std::span<const std::byte> bytes
+)
+{
+  const Block &range = this->_blocks[block];
+  const Pool &pool = this->_pools[range.pool];
+
+  size_t start = target == GL_ARRAY_BUFFER ? range.first_vertex * pool.stride
+                                           : range.first_word * WORD;
+  glBindBuffer(
+    GL_COPY_WRITE_BUFFER, target == GL_ARRAY_BUFFER ? pool.VBO : pool.EBO
+  );
+  glBufferSubData(
+    GL_COPY_WRITE_BUFFER, start + offset, bytes.size(), bytes.data()
+  );
+}
+
+// Read through the copy target so no VAO state is touched
+void Geometry_arena::read(
+  uint32_t block, GLenum target, size_t offset, std::span<std::byte> out
+) const
+{
+  const Block &range = this->_blocks[block];
+  const Pool &pool = this->_pools[range.pool];
+
+  size_t start = target == GL_ARRAY_BUFFER ? range.first_vertex * pool.stride
+                                           : range.first_word * WORD;
+  glBindBuffer(
+    GL_COPY_READ_BUFFER, target == GL_ARRAY_BUFFER ? pool.VBO : pool.EBO
+  );
+  glGetBufferSubData(
+    GL_COPY_READ_BUFFER, start + offset, out.size(), out.data()
+  );
+}
+
+size_t Geometry_arena::bytes(uint32_t block) const
+{
+  if (block >= this->_blocks.size() || !this->_blocks[block].live) {
+    return 0;
+  }
+  const Block &range = this->_blocks[block];
+  return range.vertex_count * this->_pools[range.pool].stride +
+         range.word_count * WORD;
+}
+
+void Geometry_arena::bind_vertex_array(GLuint vao)
+{
+  if (this->_bound_vao != vao) {
+    glBindVertexArray(vao);
+    this->_bound_vao = vao;
+    ++this->_vertex_array_binds;
+  }
+}
+
+// Deleting the bound array reverts the binding to 0
+void Geometry_arena::forget_vertex_array(GLuint vao)
+{
+  if (this->_bound_vao == vao) {
+    this->_bound_vao = 0;
+  }
+}
+
+// Draw with the pool's VAO, only binding it when it changes
+void Geometry_arena::draw(
+  uint32_t block,
+  GLenum type,
+  size_t first_byte,
+  GLsizei count,
+  const Instance_range &instances
+)
+{
+  const Block &range = this->_blocks[block];
+  const Pool &pool = this->_pools[range.pool];
+  this->bind_vertex_array(pool.VAO);
+  instances.apply();
+
+  glDrawElementsInstancedBaseVertex(
+    GL_TRIANGLES,
+    count,
+    type,
+    (void *)(uintptr_t)(range.first_word * WORD + first_byte),
+    instances.count,
+    static_cast<GLint>(range.first_vertex)
+  );
+}
+
+// Index offsets are in indices rather than bytes, and suit any index type
+// since blocks start on whole words
+Geometry_arena::Indirect_draw Geometry_arena::indirect(
+  uint32_t block,
+  GLenum type,
+  size_t first_byte,
+  GLsizei count,
+  GLuint instance_count,
+  GLuint first_instance
+) const
+{
+  const Block &range = this->_blocks[block];
+  size_t index_size = type == GL_UNSIGNED_BYTE    ? 1
+                      : type == GL_UNSIGNED_SHORT ? 2
+                                                  : 4;
+  Draw_command command{
+    static_cast<GLuint>(count),
+    instance_count,
+    static_cast<GLuint>((range.first_word * WORD + first_byte) / index_size),
+    static_cast<GLint>(range.first_vertex),
+    first_instance
+  };
+  return {range.pool, type, command};
+}
+
+// Draw with the pool's VAO, only binding it when it changes
+void Geometry_arena::multi_draw(
+  size_t pool,
+  GLenum type,
+  size_t offset,
+  GLsizei draw_count,
+  const Instance_range &instances
+)
+{
+  this->bind_vertex_array(this->_pools[pool].VAO);
+  instances.apply();
+
+  Gl_extensions::MultiDrawElementsIndirect(
+    GL_TRIANGLES,
+    type,
+    reinterpret_cast<const void *>(static_cast<uintptr_t>(offset)),
+    draw_count,
+    sizeof(Draw_command)
+  );
+}
+
+// Compact pools with fragmented free space
+void Geometry_arena::defragment(float threshold)
+{
+  for (size_t i = 0; i < this->_pools.size(); ++i) {
+    const Pool &pool = this->_pools[i];
+    if (pool.vertices.fragmentation() > threshold ||
+        pool.words.fragmentation() > threshold) {
+      this->compact(i);
+    }
+  }
+}
+
+// Compact pools holding any free space into buffers of the exact size
+void Geometry_arena::trim()
+{
+  for (size_t i = 0; i < this->_pools.size(); ++i) {
+    // Fitting leaves room for one element, so an empty pool already fits
+    const Pool &pool = this->_pools[i];
+    if (pool.vertices.capacity() > std::max<size_t>(pool.vertices.used(), 1) ||
+        pool.words.capacity() > std::max<size_t>(pool.words.used(), 1)) {
+      this->compact(i, true);
+    }
+  }
+}
+
+// Sum usage over the pools
+Geometry_arena::Stats Geometry_arena::stats() const
+{
+  Stats stats{this->_pools.size(), 0, 0, 0, 0, 0, 0, 0.0f};
+  stats.blocks = this->_blocks.size() - this->_free_blocks.size();
+
+  size_t free = 0;
+  size_t largest = 0;
+  for (const Pool &pool : this->_pools) {
+    stats.vertex_capacity += pool.vertices.capacity() * pool.stride;
+    stats.vertex_used += pool.vertices.used() * pool.stride;
+    stats.index_capacity += pool.words.capacity() * WORD;
+    stats.index_used += pool.words.used() * WORD;
+    stats.free_ranges +=
+      pool.vertices.free_ranges() + pool.words.free_ranges();
+
+    free += (pool.vertices.capacity() - pool.vertices.used()) * pool.stride +
+            (pool.words.capacity() - pool.words.used()) * WORD;
+    largest += pool.vertices.largest_free() * pool.stride +
+               pool.words.largest_free() * WORD;
+  }
+  if (free > 0) {
+    stats.fragmentation = 1.0f - static_cast<float>(largest) / free;
+  }
+  return stats;
+}
+
+// Delete every GL object and forget all blocks
+void Geometry_arena::clear()
+{
+  Gpu_memory &memory = Gpu_memory::shared();
+  for (Pool &pool : this->_pools) {
+    memory.release(Gpu_memory::MESH, pool.vertices.capacity() * pool.stride);
+    memory.release(Gpu_memory::INDEX, pool.words.capacity() * WORD);
+    glDeleteBuffers(1, &(pool.EBO));
+    glDeleteBuffers(1, &(pool.VBO));
+    glDeleteVertexArrays(1, &(pool.VAO));
+  }
+  this->_pools.clear();
+  this->_blocks.clear();
+  this->_free_blocks.clear();
+  this->_bound_vao = 0;
+}
+
+// -------- Private Functions -------- //
+size_t Geometry_arena::pool_for(const Vertex_format &format)
+{
+  for (size_t i = 0; i < this->_pools.size(); ++i) {
+    if (this->_pools[i].format.same_layout(format)) {
+      return i;
+    }
+  }
+
+  Pool pool{format, format.stride, 0, 0, 0, {}, {}};
+  glGenVertexArrays(1, &(pool.VAO));
+  this->grow(
+    pool,
+    std::max<size_t>(1, this->_initial_bytes / format.stride),
+    this->_initial_bytes / WORD
+  );
+  this->_pools.push_back(std::move(pool));
+  return this->_pools.size() - 1;
+}
+
+void Geometry_arena::bind_buffers(Pool &pool)
+{
+  glBindVertexArray(pool.VAO);
+  this->_bound_vao = pool.VAO;
+
+  glBindBuffer(GL_ARRAY_BUFFER, pool.VBO);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, pool.EBO);
+  pool.format.apply();
+}
+
+// Double the buffers, or more if the request is larger, keeping offsets
+void Geometry_arena::grow(Pool &pool, size_t vertices, size_t words)
+{
+  if (vertices > 0) {
+    size_t old_size = pool.vertices.capacity();
+    size_t size = std::max(2 * old_size, old_size + vertices);
+    Move keep{0, 0, old_size * pool.stride};
+    pool.VBO = Geometry_arena::reallocate(
+      pool.VBO,
+      old_size * pool.stride,
+      size * pool.stride,
+      std::span(&keep, old_size ? 1 : 0),
+      Gpu_memory::MESH
+    );
+    pool.vertices.grow(size);
+  }
+  if (words > 0) {
+    size_t old_size = pool.words.capacity();
+    size_t size = std::max(2 * old_size, old_size + words);
+    Move keep{0, 0, old_size * WORD};
+    pool.EBO = Geometry_arena::reallocate(
+      pool.EBO,
+      old_size * WORD,
+      size * WORD,
+      std::span(&keep, old_size ? 1 : 0),
+      Gpu_memory::INDEX
+    );
+    pool.words.grow(size);
+  }
+  this->bind_buffers(pool);
+}
+
+// Pack live blocks in their current order
+void Geometry_arena::compact(size_t pool_index, bool fit)
+{
+  Pool &pool = this->_pools[pool_index];
+  std::vector<Block *> blocks;
+  for (Block &block : this->_blocks) {
+    if (block.live && block.pool == pool_index) {
+      blocks.push_back(&block);
+    }
+  }
+
+  // Vertices
+  std::sort(blocks.begin(), blocks.end(), [](Block *a, Block *b) {
+    return a->first_vertex < b->first_vertex;
+  });
+  std::vector<Move> moves;
+  size_t end = 0;
+  for (Block *block : blocks) {
+    moves.push_back(
+      {block->first_vertex * pool.stride,
+       end * pool.stride,
+       block->vertex_count * pool.stride}
+    );
+    block->first_vertex = end;
+    end += block->vertex_count;
+  }
+  size_t capacity = fit ? std::max<size_t>(end, 1) : pool.vertices.capacity();
+  pool.VBO = Geometry_arena::reallocate(
+    pool.VBO,
+    pool.vertices.capacity() * pool.stride,
+    capacity * pool.stride,
+    moves,
+    Gpu_memory::MESH
+  );
+  pool.vertices.reset(end, capacity);
+
+  // Indices
+  std::sort(blocks.begin(), blocks.end(), [](Block *a, Block *b) {
+    return a->first_word < b->first_word;
+  });
+  moves.clear();
+  end = 0;
+  for (Block *block : blocks) {
+    moves.push_back(
+      {block->first_word * WORD, end * WORD, block->word_count * WORD}
+    );
+    block->first_word = end;
+    end += block->word_count;
+  }
+  capacity = fit ? std::max<size_t>(end, 1) : pool.words.capacity();
+  pool.EBO = Geometry_arena::reallocate(
+    pool.EBO,
+    pool.words.capacity() * WORD,
+    capacity * WORD,
+    moves,
+    Gpu_memory::INDEX
+  );
+  pool.words.reset(end, capacity);
+
+  this->bind_buffers(pool);
+}
+
+// -------- Static Functions -------- //
+GLuint Geometry_arena::reallocate(
+  GLuint buffer,
+  size_t old_bytes,
+  size_t bytes,
+  std::span<const Move> moves,
+  Gpu_memory::Category category
+)
+{
+  Gpu_memory::shared().allocate(category, bytes);
+  GLuint copy;
+  glGenBuffers(1, &copy);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, copy);
+  glBufferData(GL_COPY_WRITE_BUFFER, bytes, nullptr, GL_STATIC_DRAW);
+
+  glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+  for (const Move &move : moves) {
+    glCopyBufferSubData(
+      GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, move.from, move.to, move.size
+    );
+  }
+  glDeleteBuffers(1, &buffer);
+  Gpu_memory::shared().release(category, old_bytes);
+  return copy;
+}
@@ -0,0 +1,99 @@
+#include "GlExtensions.h"
+
+namespace {
+  // Check the context version against a core version
+  bool core(int major, int minor)
+  {
+    return GLVersion.major > major ||
+           (GLVersion.major == major && GLVersion.minor >= minor);
+  }
+}  // namespace
+
+bool Gl_extensions::buffer_storage = false;
+Gl_extensions::Buffer_storage_proc Gl_extensions::BufferStorage = nullptr;
+
+bool Gl_extensions::program_binary = false;
+Gl_extensions::Get_program_binary_proc Gl_extensions::GetProgramBinary =
+  nullptr;
+Gl_extensions::Program_binary_proc Gl_extensions::ProgramBinary = nullptr;
+Gl_extensions::Program_parameteri_proc Gl_extensions::ProgramParameteri =
+  nullptr;
+
+bool Gl_extensions::parallel_shader_compile = false;
+Gl_extensions::Max_shader_compiler_threads_proc
+  Gl_extensions::MaxShaderCompilerThreads = nullptr;
+
+bool Gl_extensions::multi_draw_indirect = false;
+Gl_extensions::Multi_draw_elements_indirect_proc
+  Gl_extensions::MultiDrawElementsIndirect = nullptr;
+
+// Resolve the optional entry points the context supports
+void Gl_extensions::load(GLADloadproc loader)
+{
+  if (core(4, 4) || Gl_extensions::has("GL_ARB_buffer_storage")) {
+    Gl_extensions::BufferStorage =
+      reinterpret_cast<Buffer_storage_proc>(loader("glBufferStorage"));
+    Gl_extensions::buffer_storage = Gl_extensions::BufferStorage != nullptr;
+  }
+
+  if (core(4, 1) || Gl_extensions::has("GL_ARB_get_program_binary")) {
+    Gl_extensions::GetProgramBinary = reinterpret_cast<Get_program_binary_proc>(
+      loader("glGetProgramBinary")
+    );
+    Gl_extensions::ProgramBinary =
+      reinterpret_cast<Program_binary_proc>(loader("glProgramBinary"));
+    Gl_extensions::ProgramParameteri =
+      reinterpret_cast<Program_parameteri_proc>(loader("glProgramParameteri"));
+    Gl_extensions::program_binary = Gl_extensions::GetProgramBinary &&
+                                    Gl_extensions::ProgramBinary &&
+                                    Gl_extensions::ProgramParameteri;
+  }
+
+  // Let the driver pick how many compiler threads to use
+  const char *threads = nullptr;
+  if (Gl_extensions::has("GL_KHR_parallel_shader_compile")) {
+    threads = "glMaxShaderCompilerThreadsKHR";
+  }
+  else if (Gl_extensions::has("GL_ARB_parallel_shader_compile")) {
+    threads = "glMaxShaderCompilerThreadsARB";
+  }
+  if (threads) {
+    Gl_extensions::MaxShaderCompilerThreads =
+      reinterpret_cast<Max_shader_compiler_threads_proc>(loader(threads));
+  }
+  if (Gl_extensions::MaxShaderCompilerThreads) {
+    Gl_extensions::MaxShaderCompilerThreads(0xFFFFFFFF);
+    Gl_extensions::parallel_shader_compile = true;
+  }
+
+  // The shaders stay at GLSL 3.30 and enable what they use as extensions,
+  // so those must be listed even on contexts where they are core
+  bool indirect = core(4, 3) ||
+                  (Gl_extensions::has("GL_ARB_multi_draw_indirect") &&
+                   Gl_extensions::has("GL_ARB_base_instance"));
+  bool shaders = Gl_extensions::has("GL_ARB_shader_draw_parameters") &&
+                 Gl_extensions::has("GL_ARB_shader_storage_buffer_object") &&
+                 Gl_extensions::has("GL_ARB_shading_language_420pack");
+  if (indirect && shaders) {
+    Gl_extensions::MultiDrawElementsIndirect =
+      reinterpret_cast<Multi_draw_elements_indirect_proc>(
+        loader("glMultiDrawElementsIndirect")
+      );
+    Gl_extensions::multi_draw_indirect =
+      Gl_extensions::MultiDrawElementsIndirect != nullptr;
+  }
+}
+
+// Search the indexed extension list of core profiles
+bool Gl_extensions::has(const std::string &name)
+{
+  GLint count = 0;
+  glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+  for (GLint i = 0; i < count; ++i) {
+    const GLubyte *extension = glGetStringi(GL_EXTENSIONS, i);
+    if (extension && name == reinterpret_cast<const char *>(extension)) {
+      return true;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,433 @@
+#include "GlbLoader.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <iostream>
+#include <numeric>
+#include <stdexcept>
+
+#include "MeshPacker.h"
+
+namespace {
+  constexpr uint32_t GLB_MAGIC = 0x46546C67;
+  constexpr uint32_t CHUNK_JSON = 0x4E4F534A;
+  constexpr uint32_t CHUNK_BIN = 0x004E4942;
+  constexpr int MODE_TRIANGLES = 4;
+
+  // Deepest node hierarchy followed, each level recurses once
+  constexpr size_t MAX_NODE_DEPTH = 1024;
+
+  uint32_t read_u32(const char *data)
+  {
+    uint32_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+  }
+
+  // Size of one accessor component in bytes
+  size_t component_size(GLenum component)
+  {
+    switch (component) {
+    case GL_BYTE:
+    case GL_UNSIGNED_BYTE: return 1;
+    case GL_SHORT:
+    case GL_UNSIGNED_SHORT: return 2;
+    case GL_UNSIGNED_INT:
+    case GL_FLOAT: return 4;
+    default: throw std::runtime_error("Unknown glTF component type");
+    }
+  }
+
+  // Number of components in an accessor element
+  size_t component_count(const std::string &type)
+  {
+    if (type == "SCALAR") {
+      return 1;
+    }
+    if (type == "VEC2") {
+      return 2;
+    }
+    if (type == "VEC3") {
+      return 3;
+    }
+    if (type == "VEC4" || type == "MAT2") {
+      return 4;
+    }
+    if (type == "MAT3") {
+      return 9;
+    }
+    if (type == "MAT4") {
+      return 16;
+    }
+    throw std::runtime_error("Unknown glTF accessor type: " + type);
+  }
+
+  template <typename T> T load(const std::byte *data)
+  {
+    T value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+  }
+
+  // Largest value of a tightly packed index accessor
+  uint32_t max_index(const std::byte *data, size_t count, GLenum component)
+  {
+    uint32_t max = 0;
+    for (size_t i = 0; i < count; ++i) {
+      uint32_t index =
+        component == GL_UNSIGNED_BYTE    ? load<uint8_t>(data + i)
+        : component == GL_UNSIGNED_SHORT ? load<uint16_t>(data + 2 * i)
+                                         : load<uint32_t>(data + 4 * i);
+      max = std::max(max, index);
+    }
+    return max;
+  }
+
+  // One component as a float, unsigned integers are normalised
+  float read_component(const std::byte *data, GLenum component)
+  {
+    switch (component) {
+    case GL_UNSIGNED_BYTE: return load<uint8_t>(data) / 255.0f;
+    case GL_UNSIGNED_SHORT: return load<uint16_t>(data) / 65535.0f;
+    default: return load<float>(data);
+    }
+  }
+
+  // Local transform of a node, from a matrix or from TRS properties
+  glm::mat4 node_transform(const Json &node)
+  {
+    glm::mat4 local(1.0f);
+    if (node.contains("matrix")) {
+      const Json &matrix = node["matrix"];
+      for (int i = 0; i < 16; ++i) {
+        local[i / 4][i % 4] = matrix[i].number();
+      }
+      return local;
+    }
+
+    if (node.contains("translation")) {
+      const Json &t = node["translation"];
+      local = glm::translate(
+        local, glm::vec3(t[0].number(), t[1].number(), t[2].number())
+      );
+    }
+    if (node.contains("rotation")) {
+      // glTF stores quaternions as x, y, z, w
+      const Json &r = node["rotation"];
+      glm::quat rotation(
+        r[3].number(), r[0].number(), r[1].number(), r[2].number()
+      );
+      local = local * glm::mat4_cast(rotation);
+    }
+    if (node.contains("scale")) {
+      const Json &s = node["scale"];
+      local = glm::scale(
+        local, glm::vec3(s[0].number(), s[1].number(), s[2].number())
+      );
+    }
+    return local;
+  }
+}  // namespace
+
+// Constructor
+Glb_loader::Glb_loader(const std::string &filepath) :
+  _path(filepath), _file(filepath)
+{
+  const char *data = this->_file.data();
+  size_t size = this->_file.size();
+
+  // File header
+  if (size < 20 || read_u32(data) != GLB_MAGIC || read_u32(data + 4) != 2) {
+    throw std::runtime_error("Not a glTF 2.0 binary file: " + filepath);
+  }
+  size = std::min<size_t>(size, read_u32(data + 8));
+
+  // Walk the chunks, the JSON chunk always comes first
+  size_t offset = 12;
+  while (offset + 8 <= size) {
+    uint32_t length = read_u32(data + offset);
+    uint32_t type = read_u32(data + offset + 4);
+    offset += 8;
+    if (offset + length > size) {
+      throw std::runtime_error("Truncated chunk in file: " + filepath);
+    }
+
+    std::string_view chunk(data + offset, length);
+    if (type == CHUNK_JSON && this->_doc.is_null()) {
+      this->_doc = Json::parse(chunk);
+    }
+    else if (type == CHUNK_BIN && this->_bin.empty()) {
+      this->_bin = chunk;
+    }
+    offset += length;
+  }
+
+  if (!this->_doc.is_object()) {
+    throw std::runtime_error("Missing JSON chunk in file: " + filepath);
+  }
+}
+
+// Create objects for the default scene
+std::vector<Object> Glb_loader::create_objects() const
+{
+  std::vector<Object> objects;
+  Mesh_table meshes;
+  std::vector<bool> path(
+    this->_doc.contains("nodes") ? this->_doc["nodes"].size() : 0, false
+  );
+
+  // Without scenes, every root node is drawn
+  if (this->_doc.contains("scenes")) {
+    size_t scene = this->_doc.integer("scene", 0);
+    const Json &nodes = this->_doc["scenes"][scene]["nodes"];
+    for (size_t i = 0; i < nodes.size(); ++i) {
+      this->visit(nodes[i].integer(), glm::mat4(1.0f), meshes, objects, path);
+    }
+  }
+  else if (this->_doc.contains("nodes")) {
+    for (size_t i = 0; i < this->_doc["nodes"].size(); ++i) {
+      this->visit(i, glm::mat4(1.0f), meshes, objects, path);
+    }
+  }
+
+  std::cout << "Reading file " << this->_path << " (" << objects.size()
+            << " objects, " << meshes.size() << " primitives)\n";
+  return objects;
+}
+
+// -------- Private Functions -------- //
+// Visit a node of the scene graph, refusing cycles and runaway depth
+void Glb_loader::visit(
+  size_t node,
+  const glm::mat4 &parent,
+  Mesh_table &meshes,
+  std::vector<Object> &objects,
+  std::vector<bool> &path,
+  size_t depth
+) const
+{
+  const Json &spec = this->_doc["nodes"][node];
+  if (path[node]) {
+    throw std::runtime_error("Node is its own ancestor in " + this->_path);
+  }
+  if (depth == MAX_NODE_DEPTH) {
+    throw std::runtime_error("Nodes nested too deep in " + this->_path);
+  }
+  glm::mat4 transform = parent * node_transform(spec);
+
+  // Nodes reusing a glTF mesh share its uploaded primitives
+  if (spec.contains("mesh")) {
+    size_t mesh = spec["mesh"].integer();
+    const Json &primitives = this->_doc["meshes"][mesh]["primitives"];
+    for (size_t i = 0; i < primitives.size(); ++i) {
+      auto [it, inserted] = meshes.try_emplace({mesh, i}, nullptr);
+      if (inserted) {
+        it->second = this->create_mesh(primitives[i]);
+      }
+      if (it->second) {
+        Object &obj = objects.emplace_back(it->second);
+        obj._transform = transform;
+      }
+    }
+  }
+
+  if (spec.contains("children")) {
+    path[node] = true;
+    const Json &children = spec["children"];
+    for (size_t i = 0; i < children.size(); ++i) {
+      this->visit(
+        children[i].integer(), transform, meshes, objects, path, depth + 1
+      );
+    }
+    path[node] = false;
+  }
+}
+
+// Upload one primitive straight from the binary chunk
+std::shared_ptr<Mesh> Glb_loader::create_mesh(const Json &primitive) const
+{
+  if (primitive.number("mode", MODE_TRIANGLES) != MODE_TRIANGLES) {
+    std::cerr << "Skipping non-triangle primitive in " << this->_path << '\n';
+    return nullptr;
+  }
+
+  size_t position_index = primitive["attributes"]["POSITION"].integer();
+  Accessor positions = this->accessor(position_index);
+  if (positions.component != GL_FLOAT || positions.type != "VEC3") {
+    std::cerr << "Skipping primitive with non-float positions in "
+              << this->_path << '\n';
+    return nullptr;
+  }
+
+  // Base colour of the material, white if there is none
+  glm::vec3 colour(1.0f);
+  if (primitive.contains("material")) {
+    const Json &material =
+      this->_doc["materials"][primitive["material"].integer()];
+    if (material.contains("pbrMetallicRoughness") &&
+        material["pbrMetallicRoughness"].contains("baseColorFactor")) {
+      const Json &factor =
+        material["pbrMetallicRoughness"]["baseColorFactor"];
+      colour = glm::vec3(
+        factor[0].number(), factor[1].number(), factor[2].number()
+      );
+    }
+  }
+
+  // Index data comes from the file, non-indexed primitives draw their
+  // vertices in order
+  Indices order;
+  std::span<const std::byte> index_bytes;
+  GLenum index_type = GL_UNSIGNED_INT;
+  if (primitive.contains("indices")) {
+    Accessor indices = this->accessor(primitive["indices"].integer());
+    bool index_type_ok = indices.component == GL_UNSIGNED_BYTE ||
+                         indices.component == GL_UNSIGNED_SHORT ||
+                         indices.component == GL_UNSIGNED_INT;
+    if (indices.type != "SCALAR" || !index_type_ok ||
+        indices.stride != component_size(indices.component)) {
+      throw std::runtime_error("Malformed index accessor in " + this->_path);
+    }
+
+    // Indices go to the GPU unread, so check none points past the vertices
+    if (indices.count > 0 &&
+        max_index(indices.data, indices.count, indices.component) >=
+          positions.count) {
+      throw std::runtime_error("Index out of range in file: " + this->_path);
+    }
+    index_bytes = std::span(indices.data, indices.size());
+    index_type = indices.component;
+  }
+  else {
+    order.resize(positions.count);
+    std::iota(order.begin(), order.end(), 0u);
+    index_bytes = std::as_bytes(std::span(order));
+  }
+
+  // Positions alone upload straight from the mapped file, other attributes
+  // are interleaved with them in packed types
+  const Json &attributes = primitive["attributes"];
+  std::vector<float> normals =
+    this->attribute(attributes, "NORMAL", positions.count, 3);
+  std::vector<float> uvs =
+    this->attribute(attributes, "TEXCOORD_0", positions.count, 2);
+  std::vector<float> colours =
+    this->attribute(attributes, "COLOR_0", positions.count, 4);
+
+  std::span<const std::byte> vertex_bytes(positions.data, positions.size());
+  std::vector<std::byte> packed;
+  Vertex_format format;
+  format.stride = positions.stride;
+  if (!normals.empty() || !uvs.empty() || !colours.empty()) {
+    std::vector<float> points = positions.floats(3);
+    packed = Mesh_packer::interleave(
+      {points, normals, uvs, colours}, false, format
+    );
+    vertex_bytes = packed;
+  }
+
+  auto mesh = std::make_shared<Mesh>();
+  mesh->create_buffers(
+    vertex_bytes.size(), index_bytes.size(), index_type, format
+  );
+  mesh->fill_buffer(GL_ARRAY_BUFFER, 0, vertex_bytes);
+  mesh->fill_buffer(GL_ELEMENT_ARRAY_BUFFER, 0, index_bytes);
+  mesh->finish_load(colour);
+  return mesh;
+}
+
+// Read a vertex attribute of a primitive, skipping forms that cannot be
+// converted
+std::vector<float> Glb_loader::attribute(
+  const Json &attributes,
+  const std::string &name,
+  size_t vertex_count,
+  size_t components
+) const
+{
+  if (!attributes.contains(name)) {
+    return {};
+  }
+
+  Accessor values = this->accessor(attributes[name].integer());
+  bool convertible = values.component == GL_FLOAT ||
+                     values.component == GL_UNSIGNED_BYTE ||
+                     values.component == GL_UNSIGNED_SHORT;
+  if (!convertible || values.count != vertex_count ||
+      component_count(values.type) > components) {
+    std::cerr << "Skipping unsupported " << name << " attribute in "
+              << this->_path << '\n';
+    return {};
+  }
+  return values.floats(components);
+}
+
+// Locate an accessor's data in the binary chunk
+Glb_loader::Accessor Glb_loader::accessor(size_t index) const
+{
+  const Json &spec = this->_doc["accessors"][index];
+  if (spec.contains("sparse") || !spec.contains("bufferView")) {
+    throw std::runtime_error("Unsupported sparse accessor in " + this->_path);
+  }
+
+  const Json &view = this->_doc["bufferViews"][spec["bufferView"].integer()];
+  const Json &buffer = this->_doc["buffers"][view["buffer"].integer()];
+  if (buffer.contains("uri")) {
+    throw std::runtime_error("Unsupported external buffer in " + this->_path);
+  }
+
+  Accessor result;
+  result.count = spec["count"].integer();
+  result.component = spec["componentType"].integer();
+  result.type = spec["type"].string();
+  size_t element =
+    component_size(result.component) * component_count(result.type);
+  result.stride = view.integer("byteStride", element);
+
+  size_t offset =
+    view.integer("byteOffset", 0) + spec.integer("byteOffset", 0);
+  size_t view_length = view["byteLength"].integer();
+  result.data = reinterpret_cast<const std::byte *>(this->_bin.data()) + offset;
+
+  // The accessor must fit in its view and the view in the binary chunk
+  // Counts and strides past the chunk size are rejected first, so size()
+  // cannot overflow
+  size_t view_offset = view.integer("byteOffset", 0);
+  if (result.count > this->_bin.size() || result.stride > this->_bin.size() ||
+      view_offset + view_length > this->_bin.size() ||
+      offset + result.size() > view_offset + view_length) {
+    throw std::runtime_error("Accessor out of range in " + this->_path);
+  }
+
+  return result;
+}
+
+// Bytes from the first element to the end of the last one
+size_t Glb_loader::Accessor::size() const
+{
+  if (this->count == 0) {
+    return 0;
+  }
+  size_t element =
+    component_size(this->component) * component_count(this->type);
+  return (this->count - 1) * this->stride + element;
+}
+
+// Missing components read as 1, which only colours without alpha have
+std::vector<float> Glb_loader::Accessor::floats(size_t components) const
+{
+  size_t present = component_count(this->type);
+  size_t size = component_size(this->component);
+  std::vector<float> values(this->count * components, 1.0f);
+  for (size_t i = 0; i < this->count; ++i) {
+    const std::byte *element = this->data + i * this->stride;
+    for (size_t k = 0; k < present; ++k) {
+      values[i * components + k] =
+        read_component(element + k * size, this->component);
+    }
+  }
+  return values;
+}
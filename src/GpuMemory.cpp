@@ -0,0 +1,43 @@
+#include "GpuMemory.h"
+
+#include <algorithm>
+
+// Constructor
+Gpu_memory::Gpu_memory() : _categories{}, _total{0, 0} {}
+
+// Ledger living for the whole program
+Gpu_memory &Gpu_memory::shared()
+{
+  static Gpu_memory memory;
+  return memory;
+}
+
+void Gpu_memory::allocate(Category category, size_t bytes)
+{
+  Usage &usage = this->_categories[category];
+  usage.current += bytes;
+  usage.peak = std::max(usage.peak, usage.current);
+  this->_total.current += bytes;
+  this->_total.peak = std::max(this->_total.peak, this->_total.current);
+}
+
+// Never drop below zero, whatever the caller releases
+void Gpu_memory::release(Category category, size_t bytes)
+{
+  Usage &usage = this->_categories[category];
+  bytes = std::min(bytes, usage.current);
+  usage.current -= bytes;
+  this->_total.current -= bytes;
+}
+
+// -------- Static Functions -------- //
+const char *Gpu_memory::name(Category category)
+{
+  switch (category) {
+  case MESH: return "mesh";
+  case INDEX: return "index";
+  case DYNAMIC: return "dynamic";
+  case TEXTURE: return "texture";
+  default: return "unknown";
+  }
+}
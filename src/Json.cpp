@@ -0,0 +1,358 @@
+#include "Json.h"
+
+#include <charconv>
+#include <cmath>
+#include <stdexcept>
+
+// Recursive descent parser over the document text
+class Json::Parser
+{
+  // Deepest nesting of arrays and objects, each level recurses once
+  static constexpr size_t MAX_DEPTH = 512;
+
+  std::string_view _text;
+  size_t _pos;
+  size_t _depth;
+
+  [[noreturn]] void fail(const std::string &what) const
+  {
+    throw std::runtime_error(
+      "JSON error at offset " + std::to_string(this->_pos) + ": " + what
+    );
+  }
+
+  void skip_space()
+  {
+    while (this->_pos < this->_text.size()) {
+      char c = this->_text[this->_pos];
+      if (c != ' ' && c != '\t' && c != '\n' && c != '\r') {
+        break;
+      }
+      ++this->_pos;
+    }
+  }
+
+  char peek()
+  {
+    this->skip_space();
+    if (this->_pos >= this->_text.size()) {
+      this->fail("unexpected end of document");
+    }
+    return this->_text[this->_pos];
+  }
+
+  void expect(char c)
+  {
+    if (this->peek() != c) {
+      this->fail(std::string("expected '") + c + "'");
+    }
+    ++this->_pos;
+  }
+
+  bool consume(std::string_view word)
+  {
+    if (this->_text.substr(this->_pos, word.size()) == word) {
+      this->_pos += word.size();
+      return true;
+    }
+    return false;
+  }
+
+  // Append a code point as UTF-8
+  static void append_utf8(std::string &out, unsigned int cp)
+  {
+    if (cp < 0x80) {
+      out += static_cast<char>(cp);
+    }
+    else if (cp < 0x800) {
+      out += static_cast<char>(0xC0 | (cp >> 6));
+      out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+    else if (cp < 0x10000) {
+      out += static_cast<char>(0xE0 | (cp >> 12));
+      out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+      out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+    else {
+      out += static_cast<char>(0xF0 | (cp >> 18));
+      out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+      out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+      out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+  }
+
+  unsigned int hex4()
+  {
+    // An escape cut off by the end of the text must not be read past it
+    if (this->_pos + 4 > this->_text.size()) {
+      this->fail("bad unicode escape");
+    }
+    unsigned int value = 0;
+    const char *first = this->_text.data() + this->_pos;
+    auto [ptr, err] = std::from_chars(first, first + 4, value, 16);
+    if (err != std::errc() || ptr != first + 4) {
+      this->fail("bad unicode escape");
+    }
+    this->_pos += 4;
+    return value;
+  }
+
+  std::string string()
+  {
+    this->expect('"');
+    std::string out;
+    while (true) {
+      if (this->_pos >= this->_text.size()) {
+        this->fail("unterminated string");
+      }
+      char c = this->_text[this->_pos++];
+      if (c == '"') {
+        return out;
+      }
+      if (c != '\\') {
+        out += c;
+        continue;
+      }
+
+      // Escape sequences
+      if (this->_pos >= this->_text.size()) {
+        this->fail("unterminated string");
+      }
+      char e = this->_text[this->_pos++];
+      switch (e) {
+      case '"':
+      case '\\':
+      case '/': out += e; break;
+      case 'b': out += '\b'; break;
+      case 'f': out += '\f'; break;
+      case 'n': out += '\n'; break;
+      case 'r': out += '\r'; break;
+      case 't': out += '\t'; break;
+      case 'u': {
+        unsigned int cp = this->hex4();
+        // Combine surrogate pairs, surrogates on their own encode nothing
+        if (cp >= 0xDC00 && cp < 0xE000) {
+          this->fail("unpaired surrogate");
+        }
+        if (cp >= 0xD800 && cp < 0xDC00) {
+          if (!this->consume("\\u")) {
+            this->fail("unpaired surrogate");
+          }
+          unsigned int low = this->hex4();
+          if (low < 0xDC00 || low >= 0xE000) {
+            this->fail("unpaired surrogate");
+          }
+          cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+        }
+        append_utf8(out, cp);
+        break;
+      }
+      default: this->fail("bad escape");
+      }
+    }
+  }
+
+  double number()
+  {
+    const char *first = this->_text.data() + this->_pos;
+    const char *last = this->_text.data() + this->_text.size();
+    double value;
+    auto [ptr, err] = std::from_chars(first, last, value);
+    if (err != std::errc() || ptr == first) {
+      this->fail("bad number");
+    }
+    this->_pos += ptr - first;
+    return value;
+  }
+
+public:
+  Parser(std::string_view text) : _text(text), _pos(0), _depth(0) {}
+
+  Json value()
+  {
+    Json json;
+    char c = this->peek();
+    if ((c == '{' || c == '[') && this->_depth == MAX_DEPTH) {
+      this->fail("nested too deep");
+    }
+
+    if (c == '{') {
+      ++this->_pos;
+      ++this->_depth;
+      Members members;
+      bool more = this->peek() != '}';
+      while (more) {
+        std::string key = this->string();
+        this->expect(':');
+        members.emplace_back(std::move(key), this->value());
+        more = this->peek() == ',';
+        this->_pos += more;
+      }
+      this->expect('}');
+      --this->_depth;
+      json._value = std::move(members);
+    }
+    else if (c == '[') {
+      ++this->_pos;
+      ++this->_depth;
+      Array elements;
+      bool more = this->peek() != ']';
+      while (more) {
+        elements.push_back(this->value());
+        more = this->peek() == ',';
+        this->_pos += more;
+      }
+      this->expect(']');
+      --this->_depth;
+      json._value = std::move(elements);
+    }
+    else if (c == '"') {
+      json._value = this->string();
+    }
+    else if (this->consume("true")) {
+      json._value = true;
+    }
+    else if (this->consume("false")) {
+      json._value = false;
+    }
+    else if (this->consume("null")) {
+      json._value = nullptr;
+    }
+    else {
+      json._value = this->number();
+    }
+
+    return json;
+  }
+
+  void finish()
+  {
+    this->skip_space();
+    if (this->_pos != this->_text.size()) {
+      this->fail("trailing characters");
+    }
+  }
+};
+
+// Parse a whole document
+Json Json::parse(std::string_view text)
+{
+  Parser parser(text);
+  Json root = parser.value();
+  parser.finish();
+  return root;
+}
+
+bool Json::is_null() const
+{
+  return std::holds_alternative<std::nullptr_t>(this->_value);
+}
+
+bool Json::is_number() const
+{
+  return std::holds_alternative<double>(this->_value);
+}
+
+bool Json::is_string() const
+{
+  return std::holds_alternative<std::string>(this->_value);
+}
+
+bool Json::is_array() const
+{
+  return std::holds_alternative<Array>(this->_value);
+}
+
+bool Json::is_object() const
+{
+  return std::holds_alternative<Members>(this->_value);
+}
+
+bool Json::contains(const std::string &key) const
+{
+  if (const Members *members = std::get_if<Members>(&this->_value)) {
+    for (const auto &member : *members) {
+      if (member.first == key) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+const Json &Json::operator[](const std::string &key) const
+{
+  if (const Members *members = std::get_if<Members>(&this->_value)) {
+    for (const auto &member : *members) {
+      if (member.first == key) {
+        return member.second;
+      }
+    }
+  }
+  throw std::runtime_error("JSON member not found: " + key);
+}
+
+const Json &Json::operator[](size_t index) const
+{
+  const Array *elements = std::get_if<Array>(&this->_value);
+  if (!elements || index >= elements->size()) {
+    throw std::runtime_error("JSON index out of range");
+  }
+  return (*elements)[index];
+}
+
+size_t Json::size() const
+{
+  if (const Array *elements = std::get_if<Array>(&this->_value)) {
+    return elements->size();
+  }
+  if (const Members *members = std::get_if<Members>(&this->_value)) {
+    return members->size();
+  }
+  return 0;
+}
+
+bool Json::boolean() const
+{
+  if (const bool *value = std::get_if<bool>(&this->_value)) {
+    return *value;
+  }
+  throw std::runtime_error("JSON value is not a boolean");
+}
+
+double Json::number() const
+{
+  if (const double *value = std::get_if<double>(&this->_value)) {
+    return *value;
+  }
+  throw std::runtime_error("JSON value is not a number");
+}
+
+const std::string &Json::string() const
+{
+  if (const std::string *value = std::get_if<std::string>(&this->_value)) {
+    return *value;
+  }
+  throw std::runtime_error("JSON value is not a string");
+}
+
+double Json::number(const std::string &key, double fallback) const
+{
+  return this->contains(key) ? (*this)[key].number() : fallback;
+}
+
+// Converting a negative, fractional or huge double to size_t is undefined,
+// so only integers a double holds exactly are accepted
+size_t Json::integer() const
+{
+  double value = this->number();
+  if (!(value >= 0.0 && value < 0x1p53 && value == std::floor(value))) {
+    throw std::runtime_error("JSON number is not a non-negative integer");
+  }
+  return static_cast<size_t>(value);
+}
+
+size_t Json::integer(const std::string &key, size_t fallback) const
+{
+  return this->contains(key) ? (*this)[key].integer() : fallback;
+}
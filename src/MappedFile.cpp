@@ -0,0 +1,46 @@
+#include "MappedFile.h"
+
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Constructor
+Mapped_file::Mapped_file(const std::string &filepath) :
+  _data(nullptr), _size(0)
+{
+  int fd = open(filepath.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error("Cannot open file: " + filepath);
+  }
+
+  struct stat info;
+  if (fstat(fd, &info) < 0) {
+    close(fd);
+    throw std::runtime_error("Cannot stat file: " + filepath);
+  }
+  this->_size = static_cast<size_t>(info.st_size);
+
+  // Empty files cannot be mapped, leave the view empty instead
+  if (this->_size > 0) {
+    void *addr = mmap(nullptr, this->_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (addr == MAP_FAILED) {
+      close(fd);
+      throw std::runtime_error("Cannot map file: " + filepath);
+    }
+    madvise(addr, this->_size, MADV_SEQUENTIAL);
+    this->_data = static_cast<const char *>(addr);
+  }
+
+  // The mapping stays valid after the descriptor is closed
+  close(fd);
+}
+
+// Destructor
+Mapped_file::~Mapped_file()
+{
+  if (this->_data) {
+    munmap(const_cast<char *>(this->_data), this->_size);
+  }
+}
@@ -0,0 +1,106 @@
+#include "MemoryBudget.h"
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+#include "GeometryArena.h"
+#include "GpuMemory.h"
+
+// Constructor
+Memory_budget::Memory_budget(Asset_loader &loader, size_t budget) :
+  _loader(loader), _budget(budget), _frame(1), _warned(false)
+{}
+
+// Meshes freed and reallocated at the same address replace the old entry
+void Memory_budget::track(
+  const std::shared_ptr<Mesh> &mesh,
+  const std::string &filepath,
+  const Load_options &options
+)
+{
+  this->_meshes.insert_or_assign(
+    mesh.get(), Source{mesh, filepath, options}
+  );
+}
+
+// Stamp the frame and bring evicted meshes back
+void Memory_budget::use(const std::shared_ptr<Mesh> &mesh)
+{
+  mesh->_last_drawn = this->_frame;
+  if (!mesh->_evicted) {
+    return;
+  }
+
+  auto it = this->_meshes.find(mesh.get());
+  if (it == this->_meshes.end() || it->second.filepath.empty()) {
+    mesh->restore();
+    return;
+  }
+
+  // Stays not ready, and no longer evicted, while the loader works on it
+  mesh->_evicted = false;
+  this->_loader.load(it->second.filepath, mesh, it->second.options);
+}
+
+// Evict least recently drawn meshes, then shrink the arena if that frees
+// anything
+void Memory_budget::enforce()
+{
+  uint64_t frame = this->_frame++;
+  Gpu_memory::Usage total = Gpu_memory::shared().total();
+  if (this->_budget == 0 || total.current <= this->_budget) {
+    this->_warned = false;
+    return;
+  }
+
+  // Free arena space is given back by trimming, without evicting anything
+  Geometry_arena &arena = Geometry_arena::shared();
+  Geometry_arena::Stats stats = arena.stats();
+  size_t slack = (stats.vertex_capacity - stats.vertex_used) +
+                 (stats.index_capacity - stats.index_used);
+  size_t remaining = total.current - std::min(slack, total.current);
+
+  // Resident meshes not drawn this frame, oldest first
+  std::vector<std::pair<std::shared_ptr<Mesh>, bool>> candidates;
+  for (auto it = this->_meshes.begin(); it != this->_meshes.end();) {
+    std::shared_ptr<Mesh> mesh = it->second.mesh.lock();
+    if (!mesh) {
+      it = this->_meshes.erase(it);
+      continue;
+    }
+    if (mesh->ready() && mesh->_last_drawn < frame) {
+      candidates.emplace_back(mesh, it->second.filepath.empty());
+    }
+    ++it;
+  }
+  std::sort(
+    candidates.begin(),
+    candidates.end(),
+    [](const auto &a, const auto &b) {
+      return a.first->_last_drawn < b.first->_last_drawn;
+    }
+  );
+
+  bool evicted = false;
+  for (auto &[mesh, keep_copy] : candidates) {
+    if (remaining <= this->_budget) {
+      break;
+    }
+    remaining -= std::min(arena.bytes(mesh->_block), remaining);
+    mesh->evict(keep_copy);
+    evicted = true;
+  }
+
+  // Without an eviction the free space is only worth trimming when it
+  // alone brings usage within budget, not on every frame spent over it
+  if (evicted || remaining <= this->_budget) {
+    arena.trim();
+  }
+
+  if (remaining > this->_budget && !this->_warned) {
+    std::cerr << "GPU memory budget of " << this->_budget
+              << " bytes exceeded by the meshes drawn each frame\n";
+    this->_warned = true;
+  }
+}
@@ -0,0 +1,201 @@
+#include "Mesh.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <utility>
+
+namespace {
+  // Loader workers create staging meshes alongside the GL thread
+  std::atomic<uint32_t> next_id = 0;
+}  // namespace
+
+// Constructor
+Mesh::Mesh() :
+  _id(next_id.fetch_add(1, std::memory_order_relaxed)),
+  _block(Geometry_arena::NO_BLOCK),
+  index_count(0),
+  vertex_count(0),
+  index_type(GL_UNSIGNED_INT),
+  _ready(false),
+  _colour(glm::vec3(1.0f)),
+  _source_hash(0),
+  _last_drawn(0),
+  _evicted(false)
+{}
+
+// Destructor
+Mesh::~Mesh()
+{
+  Geometry_arena::shared().release(this->_block);
+}
+
+// Upload a whole mesh
+void Mesh::load_object(
+  std::span<const std::byte> vertices,
+  std::span<const std::byte> indices,
+  GLenum type,
+  const Vertex_format &format,
+  glm::vec3 colour,
+  std::span<const Mesh_lod> lods
+)
+{
+  this->create_buffers(vertices.size(), indices.size(), type, format);
+  this->fill_buffer(GL_ARRAY_BUFFER, 0, vertices);
+  this->fill_buffer(GL_ELEMENT_ARRAY_BUFFER, 0, indices);
+  this->finish_load(colour, lods);
+}
+
+// Levels are ordered by increasing error, take the last one that fits
+size_t Mesh::pick_lod(float distance, float projection, float pixel_error) const
+{
+  size_t lod = 0;
+  for (size_t i = 1; i < this->_lods.size(); ++i) {
+    if (this->_lods[i].error * projection > pixel_error * distance) {
+      break;
+    }
+    lod = i;
+  }
+  return lod;
+}
+
+// Scale and offset that undo the quantisation of the positions
+Mesh::Uniforms Mesh::uniforms() const
+{
+  return {
+    glm::vec4(this->_format.scale, 0.0f),
+    glm::vec4(this->_format.offset, 0.0f)
+  };
+}
+
+// Draw the mesh once loaded
+void Mesh::draw(const Instance_range &instances, size_t lod) const
+{
+  const Mesh_lod &range = this->_lods[std::min(lod, this->_lods.size() - 1)];
+
+  Geometry_arena::shared().draw(
+    this->_block,
+    this->index_type,
+    range.first * Mesh::index_size(this->index_type),
+    range.count,
+    instances
+  );
+}
+
+bool Mesh::indirect(
+  Geometry_arena::Indirect_draw &draw,
+  GLuint instance_count,
+  GLuint first_instance,
+  size_t lod
+) const
+{
+  const Mesh_lod &range = this->_lods[std::min(lod, this->_lods.size() - 1)];
+
+  draw = Geometry_arena::shared().indirect(
+    this->_block,
+    this->index_type,
+    range.first * Mesh::index_size(this->index_type),
+    range.count,
+    instance_count,
+    first_instance
+  );
+  return true;
+}
+
+// -------- Private Functions -------- //
+void Mesh::create_buffers(
+  size_t vertex_bytes,
+  size_t index_bytes,
+  GLenum type,
+  const Vertex_format &format
+)
+{
+  // Record array sizes for later use
+  this->index_count = index_bytes / Mesh::index_size(type);
+  this->index_type = type;
+  this->vertex_count = vertex_bytes / format.stride;
+  this->_format = format;
+
+  // Allocate arena space to be filled later
+  Geometry_arena &arena = Geometry_arena::shared();
+  arena.release(this->_block);
+  this->_block = arena.allocate(format, vertex_bytes, index_bytes);
+}
+
+void Mesh::fill_buffer(
+  GLenum target, size_t offset, std::span<const std::byte> bytes
+)
+{
+  Geometry_arena::shared().fill(this->_block, target, offset, bytes);
+}
+
+void Mesh::finish_load(glm::vec3 colour, std::span<const Mesh_lod> lods)
+{
+  this->_lods.assign(lods.begin(), lods.end());
+  if (this->_lods.empty()) {
+    this->_lods.push_back({0, static_cast<uint32_t>(this->index_count), 0});
+  }
+  this->_colour = colour;
+  this->_ready = true;
+}
+
+void Mesh::swap(Mesh &other)
+{
+  std::swap(this->_block, other._block);
+  std::swap(this->index_count, other.index_count);
+  std::swap(this->vertex_count, other.vertex_count);
+  std::swap(this->index_type, other.index_type);
+  std::swap(this->_ready, other._ready);
+  std::swap(this->_colour, other._colour);
+  std::swap(this->_source_hash, other._source_hash);
+  std::swap(this->_format, other._format);
+  std::swap(this->_lods, other._lods);
+  std::swap(this->_evicted, other._evicted);
+  std::swap(this->_saved_vertices, other._saved_vertices);
+  std::swap(this->_saved_indices, other._saved_indices);
+}
+
+void Mesh::evict(bool keep_copy)
+{
+  Geometry_arena &arena = Geometry_arena::shared();
+  if (keep_copy) {
+    this->_saved_vertices.resize(this->vertex_count * this->_format.stride);
+    this->_saved_indices.resize(
+      this->index_count * Mesh::index_size(this->index_type)
+    );
+    arena.read(this->_block, GL_ARRAY_BUFFER, 0, this->_saved_vertices);
+    arena.read(this->_block, GL_ELEMENT_ARRAY_BUFFER, 0, this->_saved_indices);
+  }
+
+  arena.release(this->_block);
+  this->_block = Geometry_arena::NO_BLOCK;
+  this->_ready = false;
+  this->_evicted = true;
+}
+
+// The levels of detail and format were kept, only the data goes back up
+void Mesh::restore()
+{
+  this->create_buffers(
+    this->_saved_vertices.size(),
+    this->_saved_indices.size(),
+    this->index_type,
+    this->_format
+  );
+  this->fill_buffer(GL_ARRAY_BUFFER, 0, this->_saved_vertices);
+  this->fill_buffer(GL_ELEMENT_ARRAY_BUFFER, 0, this->_saved_indices);
+
+  // Free the CPU copy until the next eviction
+  std::vector<std::byte>().swap(this->_saved_vertices);
+  std::vector<std::byte>().swap(this->_saved_indices);
+  this->_ready = true;
+  this->_evicted = false;
+}
+
+// -------- Static Functions -------- //
+size_t Mesh::index_size(GLenum type)
+{
+  return type == GL_UNSIGNED_BYTE    ? 1
+         : type == GL_UNSIGNED_SHORT ? 2
+                                     : 4;
+}
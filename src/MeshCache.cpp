@@ -0,0 +1,303 @@
+#include "MeshCache.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+  constexpr char MAGIC[4] = {'M', 'S', 'H', 'C'};
+  constexpr uint32_t VERSION = 4;
+  constexpr uint64_t PRIME = 0x100000001b3ULL;
+
+  // Size and modification time of a file
+  bool stat_file(const std::string &path, uint64_t &size, int64_t &mtime)
+  {
+    struct stat info;
+    if (stat(path.c_str(), &info) < 0) {
+      return false;
+    }
+    size = static_cast<uint64_t>(info.st_size);
+    mtime = static_cast<int64_t>(info.st_mtim.tv_sec) * 1000000000 +
+            info.st_mtim.tv_nsec;
+    return true;
+  }
+}  // namespace
+
+// -------- Static Functions -------- //
+// Open the cache if it is still valid for the source
+std::unique_ptr<Mesh_cache>
+Mesh_cache::open(const std::string &source, uint32_t options)
+{
+  uint64_t size;
+  int64_t mtime;
+  std::string path = Mesh_cache::cache_path(source, options);
+  if (!stat_file(source, size, mtime) || access(path.c_str(), R_OK) != 0) {
+    return nullptr;
+  }
+
+  std::unique_ptr<Mesh_cache> cache(new Mesh_cache(path));
+  const Header *header = cache->_header;
+  if (!header || header->source_size != size || header->options != options) {
+    return nullptr;
+  }
+
+  // A touched but unchanged source keeps the cache, otherwise recompile
+  if (header->source_mtime != mtime) {
+    Mapped_file text(source);
+    if (Mesh_cache::content_hash(text.view()) != header->source_hash) {
+      return nullptr;
+    }
+  }
+
+  return cache;
+}
+
+// Taken before parsing, so an edit made while parsing leaves a stale stamp
+// that only costs the next open a hash
+bool Mesh_cache::stamp(const std::string &source, Stamp &stamp)
+{
+  return stat_file(source, stamp.size, stamp.mtime);
+}
+
+// Write a cache file for the source
+void Mesh_cache::write(
+  const std::string &source,
+  const Stamp &stamp,
+  const Vertex_streams &streams,
+  std::span<const unsigned int> indices,
+  std::span<const Mesh_lod> lods,
+  glm::vec3 colour,
+  uint32_t options
+)
+{
+  Header header{};
+  std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version = VERSION;
+  header.source_size = stamp.size;
+  header.source_mtime = stamp.mtime;
+  header.source_hash = stamp.hash;
+  header.vertex_count = streams.positions.size();
+  header.index_count = indices.size();
+  header.lod_count = lods.size();
+  header.colour[0] = colour.r;
+  header.colour[1] = colour.g;
+  header.colour[2] = colour.b;
+  header.options = options;
+  header.normal_count = streams.normals.size();
+  header.uv_count = streams.uvs.size();
+  header.colour_count = streams.colours.size();
+
+  // Write to a temporary file and swap it in so readers never see a
+  // partially written cache
+  std::string path = Mesh_cache::cache_path(source, options);
+  static std::atomic<unsigned> counter = 0;
+  std::string tmp_path = path + ".tmp" + std::to_string(getpid()) + "." +
+                         std::to_string(counter++);
+  std::ofstream outfile(tmp_path, std::ios::binary | std::ios::trunc);
+  if (!outfile.is_open()) {
+    throw std::runtime_error("Cannot open file: " + tmp_path);
+  }
+  outfile.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  outfile.write(reinterpret_cast<const char *>(lods.data()), lods.size_bytes());
+  outfile.write(
+    reinterpret_cast<const char *>(streams.positions.data()),
+    streams.positions.size_bytes()
+  );
+  outfile.write(
+    reinterpret_cast<const char *>(indices.data()), indices.size_bytes()
+  );
+  for (std::span<const float> stream :
+       {streams.normals, streams.uvs, streams.colours}) {
+    outfile.write(
+      reinterpret_cast<const char *>(stream.data()), stream.size_bytes()
+    );
+  }
+  outfile.close();
+  if (!outfile) {
+    std::remove(tmp_path.c_str());
+    throw std::runtime_error("Cannot write file: " + tmp_path);
+  }
+
+  if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+    std::remove(tmp_path.c_str());
+    throw std::runtime_error("Cannot write file: " + path);
+  }
+}
+
+uint64_t Mesh_cache::content_hash(std::string_view bytes)
+{
+  Hasher hasher;
+  hasher.update(bytes);
+  return hasher.digest();
+}
+
+// Cache files live next to their source
+std::string
+Mesh_cache::cache_path(const std::string &source, uint32_t options)
+{
+  if (options != 0) {
+    return source + "." + std::to_string(options) + ".mesh";
+  }
+  return source + ".mesh";
+}
+
+// -------- Hasher Functions -------- //
+// 64-bit FNV-1a over 8 byte words, then the trailing bytes and the length
+Mesh_cache::Hasher::Hasher() :
+  _hash(0xcbf29ce484222325ULL), _size(0), _tail{}, _tail_size(0)
+{}
+
+void Mesh_cache::Hasher::update(std::string_view bytes)
+{
+  this->_size += bytes.size();
+
+  // Finish the word the last piece left open
+  size_t i = 0;
+  while (this->_tail_size > 0 && i < bytes.size()) {
+    this->_tail[this->_tail_size++] = bytes[i++];
+    if (this->_tail_size == sizeof(this->_tail)) {
+      uint64_t word;
+      std::memcpy(&word, this->_tail, sizeof(word));
+      this->_hash = (this->_hash ^ word) * PRIME;
+      this->_tail_size = 0;
+    }
+  }
+  if (this->_tail_size > 0) {
+    return;
+  }
+
+  uint64_t hash = this->_hash;
+  for (; i + sizeof(uint64_t) <= bytes.size(); i += sizeof(uint64_t)) {
+    uint64_t word;
+    std::memcpy(&word, bytes.data() + i, sizeof(word));
+    hash = (hash ^ word) * PRIME;
+  }
+  this->_hash = hash;
+
+  std::memcpy(this->_tail, bytes.data() + i, bytes.size() - i);
+  this->_tail_size = bytes.size() - i;
+}
+
+uint64_t Mesh_cache::Hasher::digest() const
+{
+  uint64_t hash = this->_hash;
+  for (size_t i = 0; i < this->_tail_size; ++i) {
+    hash = (hash ^ static_cast<unsigned char>(this->_tail[i])) * PRIME;
+  }
+  return (hash ^ this->_size) * PRIME;
+}
+
+// -------- Member Functions -------- //
+std::span<const float> Mesh_cache::vertices() const
+{
+  const char *payload = this->_file.data() + sizeof(Header) +
+                        this->_header->lod_count * sizeof(Mesh_lod);
+  return {
+    reinterpret_cast<const float *>(payload), this->_header->vertex_count
+  };
+}
+
+std::span<const unsigned int> Mesh_cache::indices() const
+{
+  const char *payload = this->_file.data() + sizeof(Header) +
+                        this->_header->lod_count * sizeof(Mesh_lod) +
+                        this->_header->vertex_count * sizeof(float);
+  return {
+    reinterpret_cast<const unsigned int *>(payload),
+    this->_header->index_count
+  };
+}
+
+std::span<const Mesh_lod> Mesh_cache::lods() const
+{
+  const char *payload = this->_file.data() + sizeof(Header);
+  return {
+    reinterpret_cast<const Mesh_lod *>(payload), this->_header->lod_count
+  };
+}
+
+// Attribute streams follow the indices
+Vertex_streams Mesh_cache::streams() const
+{
+  const Header *header = this->_header;
+  const float *stream = reinterpret_cast<const float *>(
+    this->indices().data() + header->index_count
+  );
+
+  Vertex_streams streams;
+  streams.positions = this->vertices();
+  streams.normals = {stream, header->normal_count};
+  stream += header->normal_count;
+  streams.uvs = {stream, header->uv_count};
+  stream += header->uv_count;
+  streams.colours = {stream, header->colour_count};
+  return streams;
+}
+
+glm::vec3 Mesh_cache::colour() const
+{
+  const float *c = this->_header->colour;
+  return glm::vec3(c[0], c[1], c[2]);
+}
+
+// -------- Private Functions -------- //
+// Constructor, leaves the header null if the file is not a valid cache
+Mesh_cache::Mesh_cache(const std::string &cache_file) :
+  _file(cache_file), _header(nullptr)
+{
+  if (this->_file.size() < sizeof(Header)) {
+    return;
+  }
+
+  const auto *header = reinterpret_cast<const Header *>(this->_file.data());
+  size_t expected = sizeof(Header) + header->lod_count * sizeof(Mesh_lod) +
+                    header->vertex_count * sizeof(float) +
+                    header->index_count * sizeof(unsigned int) +
+                    (static_cast<size_t>(header->normal_count) +
+                     header->uv_count + header->colour_count) *
+                      sizeof(float);
+  if (std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 ||
+      header->version != VERSION || this->_file.size() != expected) {
+    return;
+  }
+
+  // Cached data skips Obj_spec::validate, so hold it to the same rules:
+  // whole triangles, attributes for every vertex or none
+  size_t vertices = header->vertex_count / 3;
+  if (header->vertex_count % 3 != 0 || header->index_count % 3 != 0 ||
+      (header->normal_count != 0 && header->normal_count != 3 * vertices) ||
+      (header->uv_count != 0 && header->uv_count != 2 * vertices) ||
+      (header->colour_count != 0 && header->colour_count != 4 * vertices)) {
+    return;
+  }
+
+  // Levels of detail must stay inside the index buffer
+  const auto *lods = reinterpret_cast<const Mesh_lod *>(header + 1);
+  for (uint32_t i = 0; i < header->lod_count; ++i) {
+    if (lods[i].first > header->index_count ||
+        lods[i].count > header->index_count - lods[i].first) {
+      return;
+    }
+  }
+
+  // Indices must name a vertex
+  const auto *indices = reinterpret_cast<const unsigned int *>(
+    reinterpret_cast<const float *>(lods + header->lod_count) +
+    header->vertex_count
+  );
+  bool out_of_range = std::any_of(
+    indices,
+    indices + header->index_count,
+    [&](unsigned int index) { return index >= vertices; }
+  );
+  if (out_of_range) {
+    return;
+  }
+
+  this->_header = header;
+}
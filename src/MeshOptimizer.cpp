@@ -0,0 +1,386 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <glm/glm.hpp>
+#include <iostream>
+#include <limits>
+#include <numeric>
+
+namespace {
+  constexpr size_t NONE = std::numeric_limits<size_t>::max();
+
+  // FIFO post-transform cache. A vertex is cached while fewer than size
+  // misses have happened since it was last transformed.
+  class Fifo_cache
+  {
+    std::vector<unsigned int> _stamps;
+    unsigned int _time;
+    unsigned int _size;
+
+  public:
+    Fifo_cache(size_t vertex_count, unsigned int size) :
+      _stamps(vertex_count, 0), _time(size + 1), _size(size)
+    {}
+
+    // Look up a vertex, returns 1 if it had to be transformed
+    unsigned int touch(unsigned int vertex)
+    {
+      if (this->_time - this->_stamps[vertex] <= this->_size) {
+        return 0;
+      }
+      this->_stamps[vertex] = this->_time++;
+      return 1;
+    }
+
+    // Look up the three vertices of a triangle
+    unsigned int touch(const unsigned int *triangle)
+    {
+      return this->touch(triangle[0]) + this->touch(triangle[1]) +
+             this->touch(triangle[2]);
+    }
+
+    // Evict everything
+    void flush() { this->_time += this->_size; }
+  };
+
+  // Position of a vertex
+  glm::vec3 position(std::span<const float> vertices, unsigned int vertex)
+  {
+    const float *p = &vertices[3 * static_cast<size_t>(vertex)];
+    return glm::vec3(p[0], p[1], p[2]);
+  }
+}  // namespace
+
+// -------- Static Functions -------- //
+// Count cache misses over the index buffer
+Mesh_optimizer::Cache_stats Mesh_optimizer::analyze(
+  std::span<const unsigned int> indices,
+  size_t vertex_count,
+  unsigned cache_size
+)
+{
+  size_t triangle_count = indices.size() / 3;
+  if (triangle_count == 0) {
+    return {0.0, 0.0};
+  }
+
+  Fifo_cache cache(vertex_count, cache_size);
+  std::vector<bool> used(vertex_count, false);
+  size_t misses = 0;
+  size_t used_count = 0;
+  for (size_t i = 0; i < 3 * triangle_count; ++i) {
+    misses += cache.touch(indices[i]);
+    if (!used[indices[i]]) {
+      used[indices[i]] = true;
+      ++used_count;
+    }
+  }
+
+  return {
+    static_cast<double>(misses) / triangle_count,
+    static_cast<double>(misses) / used_count
+  };
+}
+
+// Run every stage and report the change in cache efficiency
+std::vector<unsigned int> Mesh_optimizer::optimize(
+  const std::string &name,
+  std::vector<float> &vertices,
+  std::vector<unsigned int> &indices
+)
+{
+  // Leave meshes the stages cannot handle as they are
+  size_t vertex_count = vertices.size() / 3;
+  if (vertices.size() % 3 != 0 || indices.size() % 3 != 0) {
+    std::cerr << "Cannot optimise mesh with partial elements: " << name << '\n';
+    return {};
+  }
+  if (std::any_of(indices.begin(), indices.end(), [&](unsigned int index) {
+        return index >= vertex_count;
+      })) {
+    std::cerr << "Cannot optimise mesh with bad indices: " << name << '\n';
+    return {};
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  Cache_stats before = Mesh_optimizer::analyze(indices, vertex_count);
+
+  std::vector<size_t> clusters;
+  indices =
+    Mesh_optimizer::optimize_vertex_cache(indices, vertex_count, clusters);
+  indices = Mesh_optimizer::optimize_overdraw(indices, vertices, clusters);
+  std::vector<unsigned int> remap =
+    Mesh_optimizer::optimize_vertex_fetch(vertices, indices);
+
+  Cache_stats after = Mesh_optimizer::analyze(indices, vertices.size() / 3);
+  std::chrono::duration<double, std::milli> elapsed =
+    std::chrono::steady_clock::now() - start;
+
+  std::cout << "Optimised mesh " << name << " in " << elapsed.count()
+            << " ms: ACMR " << before.acmr << " -> " << after.acmr
+            << ", ATVR " << before.atvr << " -> " << after.atvr << '\n';
+  return remap;
+}
+
+// Tipsify: fan around recently used vertices, preferring those that will
+// still be cached once their remaining triangles are emitted
+std::vector<unsigned int> Mesh_optimizer::optimize_vertex_cache(
+  std::span<const unsigned int> indices,
+  size_t vertex_count,
+  std::vector<size_t> &clusters,
+  unsigned cache_size
+)
+{
+  size_t triangle_count = indices.size() / 3;
+  clusters.clear();
+
+  // Triangles around each vertex, as ranges of one flat list
+  std::vector<size_t> offsets(vertex_count + 1, 0);
+  for (size_t i = 0; i < 3 * triangle_count; ++i) {
+    ++offsets[indices[i] + 1];
+  }
+  std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+  std::vector<unsigned int> adjacency(3 * triangle_count);
+  {
+    std::vector<size_t> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < 3 * triangle_count; ++i) {
+      adjacency[fill[indices[i]]++] = i / 3;
+    }
+  }
+
+  // Triangles still to be emitted around each vertex
+  std::vector<unsigned int> live(vertex_count);
+  for (size_t v = 0; v < vertex_count; ++v) {
+    live[v] = offsets[v + 1] - offsets[v];
+  }
+
+  std::vector<unsigned int> stamps(vertex_count, 0);
+  std::vector<bool> emitted(triangle_count, false);
+  std::vector<unsigned int> dead_end;
+  std::vector<unsigned int> candidates;
+  unsigned int time = cache_size + 1;
+  size_t cursor = 0;
+
+  std::vector<unsigned int> result;
+  result.reserve(3 * triangle_count);
+
+  size_t fan = NONE;
+  while (true) {
+    // Pick the next vertex to fan around
+    size_t next = NONE;
+    unsigned int best = 0;
+    for (unsigned int v : candidates) {
+      if (live[v] == 0) {
+        continue;
+      }
+      // Vertices that would be evicted before their fan is done score 0
+      unsigned int priority = 0;
+      if (time - stamps[v] + 2 * live[v] <= cache_size) {
+        priority = time - stamps[v];
+      }
+      if (next == NONE || priority > best) {
+        next = v;
+        best = priority;
+      }
+    }
+
+    // Nothing useful nearby, back out through recent vertices or move on to
+    // the next vertex in input order
+    if (next == NONE) {
+      while (!dead_end.empty() && next == NONE) {
+        if (live[dead_end.back()] > 0) {
+          next = dead_end.back();
+        }
+        dead_end.pop_back();
+      }
+      while (next == NONE && cursor < vertex_count) {
+        if (live[cursor] > 0) {
+          next = cursor;
+        }
+        ++cursor;
+      }
+      if (next == NONE) {
+        break;
+      }
+      clusters.push_back(result.size() / 3);
+    }
+    fan = next;
+
+    // Emit the live triangles around the fanning vertex
+    candidates.clear();
+    for (size_t k = offsets[fan]; k < offsets[fan + 1]; ++k) {
+      unsigned int triangle = adjacency[k];
+      if (emitted[triangle]) {
+        continue;
+      }
+      emitted[triangle] = true;
+
+      for (int corner = 0; corner < 3; ++corner) {
+        unsigned int v = indices[3 * static_cast<size_t>(triangle) + corner];
+        result.push_back(v);
+        dead_end.push_back(v);
+        candidates.push_back(v);
+        --live[v];
+        if (time - stamps[v] > cache_size) {
+          stamps[v] = time++;
+        }
+      }
+    }
+  }
+
+  return result;
+}
+
+// Split cache-ordered runs into clusters and draw the outward facing ones
+// first, so they tend to occlude the rest of the mesh
+std::vector<unsigned int> Mesh_optimizer::optimize_overdraw(
+  std::span<const unsigned int> indices,
+  std::span<const float> vertices,
+  std::span<const size_t> clusters,
+  double threshold,
+  unsigned cache_size
+)
+{
+  size_t triangle_count = indices.size() / 3;
+  if (triangle_count == 0) {
+    return {indices.begin(), indices.end()};
+  }
+
+  // Split each run wherever its miss ratio so far is close enough to that
+  // of the whole run
+  Fifo_cache cache(vertices.size() / 3, cache_size);
+  std::vector<size_t> starts;
+  for (size_t c = 0; c < clusters.size(); ++c) {
+    size_t first = clusters[c];
+    size_t last = c + 1 < clusters.size() ? clusters[c + 1] : triangle_count;
+
+    cache.flush();
+    size_t run_misses = 0;
+    for (size_t t = first; t < last; ++t) {
+      run_misses += cache.touch(&indices[3 * t]);
+    }
+    double limit = threshold * run_misses / (last - first);
+
+    cache.flush();
+    starts.push_back(first);
+    size_t misses = 0;
+    for (size_t t = first; t + 1 < last; ++t) {
+      misses += cache.touch(&indices[3 * t]);
+      if (static_cast<double>(misses) / (t + 1 - starts.back()) <= limit) {
+        starts.push_back(t + 1);
+        cache.flush();
+        misses = 0;
+      }
+    }
+  }
+  if (starts.empty() || starts.front() != 0) {
+    starts.insert(starts.begin(), 0);
+  }
+
+  // Area weighted centroid and normal of every cluster
+  std::vector<glm::vec3> centroids(starts.size(), glm::vec3(0.0f));
+  std::vector<glm::vec3> normals(starts.size(), glm::vec3(0.0f));
+  glm::vec3 mesh_centroid(0.0f);
+  float mesh_area = 0.0f;
+  for (size_t c = 0; c < starts.size(); ++c) {
+    size_t last = c + 1 < starts.size() ? starts[c + 1] : triangle_count;
+    float area = 0.0f;
+    for (size_t t = starts[c]; t < last; ++t) {
+      glm::vec3 a = position(vertices, indices[3 * t]);
+      glm::vec3 b = position(vertices, indices[3 * t + 1]);
+      glm::vec3 d = position(vertices, indices[3 * t + 2]);
+      glm::vec3 normal = glm::cross(b - a, d - a);
+      float weight = glm::length(normal);
+      centroids[c] += (a + b + d) * (weight / 3.0f);
+      normals[c] += normal;
+      area += weight;
+    }
+    mesh_centroid += centroids[c];
+    mesh_area += area;
+    if (area > 0.0f) {
+      centroids[c] /= area;
+    }
+  }
+  if (mesh_area > 0.0f) {
+    mesh_centroid /= mesh_area;
+  }
+
+  // Sort clusters by how far they face out from the centre
+  std::vector<float> keys(starts.size());
+  for (size_t c = 0; c < starts.size(); ++c) {
+    float length = glm::length(normals[c]);
+    keys[c] = length > 0.0f ? glm::dot(
+                                centroids[c] - mesh_centroid,
+                                normals[c] / length
+                              )
+                            : 0.0f;
+  }
+  std::vector<size_t> order(starts.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    return keys[a] > keys[b];
+  });
+
+  std::vector<unsigned int> result;
+  result.reserve(3 * triangle_count);
+  for (size_t c : order) {
+    size_t last = c + 1 < starts.size() ? starts[c + 1] : triangle_count;
+    result.insert(
+      result.end(), indices.begin() + 3 * starts[c], indices.begin() + 3 * last
+    );
+  }
+
+  return result;
+}
+
+// Number vertices by first use and move them to match
+std::vector<unsigned int> Mesh_optimizer::optimize_vertex_fetch(
+  std::vector<float> &vertices, std::vector<unsigned int> &indices
+)
+{
+  std::vector<unsigned int> remap(vertices.size() / 3, UNUSED);
+  std::vector<float> reordered;
+  reordered.reserve(vertices.size());
+
+  for (unsigned int &index : indices) {
+    if (remap[index] == UNUSED) {
+      remap[index] = reordered.size() / 3;
+      const float *p = &vertices[3 * static_cast<size_t>(index)];
+      reordered.insert(reordered.end(), p, p + 3);
+    }
+    index = remap[index];
+  }
+
+  vertices = std::move(reordered);
+  return remap;
+}
+
+// Scatter each used vertex's values to its new place
+void Mesh_optimizer::remap_attribute(
+  std::span<const unsigned int> remap,
+  size_t components,
+  std::vector<float> &values
+)
+{
+  // Absent attributes stay absent
+  if (values.empty()) {
+    return;
+  }
+
+  size_t used = std::count_if(remap.begin(), remap.end(), [](unsigned int i) {
+    return i != UNUSED;
+  });
+  std::vector<float> reordered(used * components);
+  for (size_t i = 0; i < remap.size(); ++i) {
+    if (remap[i] != UNUSED) {
+      std::copy_n(
+        &values[components * i],
+        components,
+        &reordered[components * static_cast<size_t>(remap[i])]
+      );
+    }
+  }
+
+  values = std::move(reordered);
+}
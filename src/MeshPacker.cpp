@@ -0,0 +1,174 @@
+#include "MeshPacker.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <utility>
+
+namespace {
+  // Convert each index to the narrower type T
+  template <typename T>
+  std::vector<std::byte> narrow(std::span<const unsigned int> indices)
+  {
+    std::vector<std::byte> bytes(indices.size() * sizeof(T));
+    T *out = reinterpret_cast<T *>(bytes.data());
+    for (size_t i = 0; i < indices.size(); ++i) {
+      out[i] = static_cast<T>(indices[i]);
+    }
+    return bytes;
+  }
+
+  // Layout choices, a set of these bits picks one of LAYOUTS layouts
+  constexpr unsigned QUANTIZE = 1 << 0;
+  constexpr unsigned NORMALS = 1 << 1;
+  constexpr unsigned UVS = 1 << 2;
+  constexpr unsigned COLOURS = 1 << 3;
+  constexpr unsigned LAYOUTS = 1 << 4;
+
+  // Layout with attribute A appended if Use is set
+  template <typename Layout, bool Use, typename A> struct Append {
+    using type = Layout;
+  };
+
+  template <typename... Attributes, typename A>
+  struct Append<Vertex_layout<Attributes...>, true, A> {
+    using type = Vertex_layout<Attributes..., A>;
+  };
+
+  template <typename Layout, bool Use, typename A>
+  using Append_t = typename Append<Layout, Use, A>::type;
+
+  // Layout for a set of layout bits
+  template <unsigned Bits> struct Mesh_layout {
+    static constexpr Packing POSITIONS =
+      Bits & QUANTIZE ? Packing::UNORM16x4 : Packing::FLOAT3;
+
+    using Positions = Vertex_layout<Attribute<POSITION, POSITIONS>>;
+    using Normals = Append_t<
+      Positions,
+      (Bits & NORMALS) != 0,
+      Attribute<NORMAL, Packing::SNORM10x3>>;
+    using Uvs =
+      Append_t<Normals, (Bits & UVS) != 0, Attribute<TEXCOORD, Packing::HALF2>>;
+    using type = Append_t<
+      Uvs,
+      (Bits & COLOURS) != 0,
+      Attribute<COLOUR, Packing::UNORM8x4>>;
+  };
+
+  using Interleaver = void (*)(
+    const Vertex_streams &streams,
+    const Position_map &map,
+    std::vector<std::byte> &bytes,
+    Vertex_format &format
+  );
+
+  template <unsigned Bits>
+  void interleave_as(
+    const Vertex_streams &streams,
+    const Position_map &map,
+    std::vector<std::byte> &bytes,
+    Vertex_format &format
+  )
+  {
+    using Layout = typename Mesh_layout<Bits>::type;
+    format = Layout::format();
+    bytes.resize(streams.positions.size() / 3 * Layout::STRIDE);
+    Layout::pack(streams, map, bytes.data());
+  }
+
+  // Every layout instantiated up front, indexed by its bits
+  template <unsigned... Bits>
+  constexpr std::array<Interleaver, sizeof...(Bits)>
+  interleavers(std::integer_sequence<unsigned, Bits...>)
+  {
+    return {&interleave_as<Bits>...};
+  }
+
+  constexpr std::array<Interleaver, LAYOUTS> INTERLEAVERS =
+    interleavers(std::make_integer_sequence<unsigned, LAYOUTS>());
+
+  // Check that a stream has an element for every vertex
+  bool covers(std::span<const float> stream, size_t size, size_t vertices)
+  {
+    return vertices > 0 && stream.size() == size * vertices;
+  }
+}  // namespace
+
+// -------- Static Functions -------- //
+GLenum Mesh_packer::index_type(std::span<const unsigned int> indices)
+{
+  unsigned int max = 0;
+  for (unsigned int index : indices) {
+    max = std::max(max, index);
+  }
+
+  if (max <= std::numeric_limits<uint8_t>::max()) {
+    return GL_UNSIGNED_BYTE;
+  }
+  if (max <= std::numeric_limits<uint16_t>::max()) {
+    return GL_UNSIGNED_SHORT;
+  }
+  return GL_UNSIGNED_INT;
+}
+
+std::vector<std::byte>
+Mesh_packer::pack_indices(std::span<const unsigned int> indices, GLenum type)
+{
+  if (type == GL_UNSIGNED_BYTE) {
+    return narrow<uint8_t>(indices);
+  }
+  if (type == GL_UNSIGNED_SHORT) {
+    return narrow<uint16_t>(indices);
+  }
+  return narrow<uint32_t>(indices);
+}
+
+// Positions alone, in the quantised layout
+std::vector<std::byte>
+Mesh_packer::quantize(std::span<const float> vertices, Vertex_format &format)
+{
+  return Mesh_packer::interleave({vertices, {}, {}, {}}, true, format);
+}
+
+// Map the bounding box of the mesh onto the full 16-bit range when
+// quantising, then pack every vertex in one pass
+std::vector<std::byte> Mesh_packer::interleave(
+  const Vertex_streams &streams, bool quantize, Vertex_format &format
+)
+{
+  size_t vertex_count = streams.positions.size() / 3;
+  unsigned bits = quantize ? QUANTIZE : 0;
+  bits |= covers(streams.normals, 3, vertex_count) ? NORMALS : 0;
+  bits |= covers(streams.uvs, 2, vertex_count) ? UVS : 0;
+  bits |= covers(streams.colours, 4, vertex_count) ? COLOURS : 0;
+
+  glm::vec3 scale(1.0f);
+  glm::vec3 offset(0.0f);
+  Position_map map;
+  if (quantize && vertex_count > 0) {
+    glm::vec3 low(std::numeric_limits<float>::max());
+    glm::vec3 high(std::numeric_limits<float>::lowest());
+    for (size_t i = 0; i < vertex_count; ++i) {
+      for (int k = 0; k < 3; ++k) {
+        low[k] = std::min(low[k], streams.positions[3 * i + k]);
+        high[k] = std::max(high[k], streams.positions[3 * i + k]);
+      }
+    }
+    scale = high - low;
+    offset = low;
+
+    // Flat axes map every position to 0
+    map.offset = low;
+    for (int k = 0; k < 3; ++k) {
+      map.factor[k] = scale[k] > 0.0f ? 1.0f / scale[k] : 0.0f;
+    }
+  }
+
+  std::vector<std::byte> bytes;
+  INTERLEAVERS[bits](streams, map, bytes, format);
+  format.scale = scale;
+  format.offset = offset;
+  return bytes;
+}
@@ -0,0 +1,92 @@
+#include "MeshRegistry.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <sys/stat.h>
+
+// Find or create the mesh for a file
+std::shared_ptr<Mesh> Mesh_registry::acquire(
+  const std::string &filepath, const Load_options &options, bool &created
+)
+{
+  // Missing files get a private mesh, the loader reports the error
+  std::string path;
+  Stamp stamp;
+  if (!Mesh_registry::stamp(filepath, path, stamp)) {
+    created = true;
+    return std::make_shared<Mesh>();
+  }
+
+  Entry &slot = this->_meshes[{path, stamp.size, stamp.mtime, options.key()}];
+  std::shared_ptr<Mesh> mesh = slot.mesh.lock();
+  created = !mesh;
+  if (created) {
+    mesh = std::make_shared<Mesh>();
+    slot = {mesh, options};
+  }
+  return mesh;
+}
+
+// Find meshes loaded from older versions of a file
+std::vector<Mesh_registry::Stale>
+Mesh_registry::changed(const std::string &filepath)
+{
+  std::vector<Stale> stale;
+  std::string path;
+  Stamp stamp;
+  if (!Mesh_registry::stamp(filepath, path, stamp)) {
+    return stale;
+  }
+
+  // Keys of a file sort together, starting from the lowest stamp
+  auto it = this->_meshes.lower_bound({path, 0, INT64_MIN, 0});
+  while (it != this->_meshes.end() && std::get<0>(it->first) == path) {
+    if (std::get<1>(it->first) == stamp.size &&
+        std::get<2>(it->first) == stamp.mtime) {
+      ++it;
+      continue;
+    }
+
+    uint32_t options = std::get<3>(it->first);
+    Entry entry = std::move(it->second);
+    it = this->_meshes.erase(it);
+    std::shared_ptr<Mesh> mesh = entry.mesh.lock();
+    if (!mesh) {
+      continue;
+    }
+    stale.push_back({mesh, entry.options});
+
+    // Meshes acquired after the write already hold the new contents
+    Entry &slot = this->_meshes[{path, stamp.size, stamp.mtime, options}];
+    if (slot.mesh.expired()) {
+      slot = std::move(entry);
+    }
+  }
+  return stale;
+}
+
+// Count live meshes, dropping entries whose mesh has been released
+size_t Mesh_registry::size()
+{
+  std::erase_if(this->_meshes, [](const auto &entry) {
+    return entry.second.mesh.expired();
+  });
+  return this->_meshes.size();
+}
+
+// -------- Static Functions -------- //
+bool Mesh_registry::stamp(
+  const std::string &filepath, std::string &path, Stamp &out
+)
+{
+  std::error_code err;
+  path = std::filesystem::weakly_canonical(filepath, err).string();
+  struct stat info;
+  if (err || stat(path.c_str(), &info) < 0) {
+    return false;
+  }
+  out.size = info.st_size;
+  out.mtime = static_cast<int64_t>(info.st_mtim.tv_sec) * 1000000000 +
+              info.st_mtim.tv_nsec;
+  return true;
+}
@@ -0,0 +1,521 @@
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <glm/glm.hpp>
+#include <numeric>
+
+namespace {
+  // Weight of the planes that hold open borders in place, relative to faces
+  constexpr float BORDER_WEIGHT = 10.0f;
+
+  // Most collapse passes made over a mesh
+  constexpr int MAX_PASSES = 100;
+
+  // Fraction of the target triangle count a result may be over by. The
+  // last few collapses each take a full pass, so stop short of them.
+  constexpr size_t TARGET_SLACK = 100;
+
+  // Sum of squared distances to a set of weighted planes
+  struct Quadric {
+    double a00 = 0, a01 = 0, a02 = 0, a11 = 0, a12 = 0, a22 = 0;
+    double b0 = 0, b1 = 0, b2 = 0;
+    double c = 0;
+    double weight = 0;
+
+    // Add the plane dot(n, p) + d = 0, n must be of unit length
+    void add_plane(glm::vec3 n, float d, double w)
+    {
+      this->a00 += w * n.x * n.x;
+      this->a01 += w * n.x * n.y;
+      this->a02 += w * n.x * n.z;
+      this->a11 += w * n.y * n.y;
+      this->a12 += w * n.y * n.z;
+      this->a22 += w * n.z * n.z;
+      this->b0 += w * n.x * d;
+      this->b1 += w * n.y * d;
+      this->b2 += w * n.z * d;
+      this->c += w * d * d;
+      this->weight += w;
+    }
+
+    Quadric &operator+=(const Quadric &other)
+    {
+      this->a00 += other.a00;
+      this->a01 += other.a01;
+      this->a02 += other.a02;
+      this->a11 += other.a11;
+      this->a12 += other.a12;
+      this->a22 += other.a22;
+      this->b0 += other.b0;
+      this->b1 += other.b1;
+      this->b2 += other.b2;
+      this->c += other.c;
+      this->weight += other.weight;
+      return *this;
+    }
+
+    // Root mean square distance of a point to the planes
+    double error(glm::vec3 p) const
+    {
+      double x = p.x, y = p.y, z = p.z;
+      double sum = this->a00 * x * x + this->a11 * y * y + this->a22 * z * z +
+                   2 * (this->a01 * x * y + this->a02 * x * z +
+                        this->a12 * y * z) +
+                   2 * (this->b0 * x + this->b1 * y + this->b2 * z) + this->c;
+      if (sum <= 0 || this->weight <= 0) {
+        return 0;
+      }
+      return std::sqrt(sum / this->weight);
+    }
+  };
+
+  // Edge collapse moving one vertex onto another
+  struct Collapse {
+    unsigned int from;
+    unsigned int to;
+    double error;
+  };
+
+  // Triangles around each vertex, as ranges of one flat list
+  class Adjacency
+  {
+    std::vector<size_t> _offsets;
+    std::vector<unsigned int> _triangles;
+    std::span<const unsigned int> _indices;
+
+  public:
+    void build(std::span<const unsigned int> indices, size_t vertex_count)
+    {
+      this->_indices = indices;
+      this->_offsets.assign(vertex_count + 1, 0);
+      for (unsigned int v : indices) {
+        ++this->_offsets[v + 1];
+      }
+      std::partial_sum(
+        this->_offsets.begin(), this->_offsets.end(), this->_offsets.begin()
+      );
+
+      this->_triangles.resize(indices.size());
+      std::vector<size_t> fill(
+        this->_offsets.begin(), this->_offsets.end() - 1
+      );
+      for (size_t i = 0; i < indices.size(); ++i) {
+        this->_triangles[fill[indices[i]]++] = i / 3;
+      }
+    }
+
+    std::span<const unsigned int> around(unsigned int vertex) const
+    {
+      return std::span(this->_triangles)
+        .subspan(
+          this->_offsets[vertex],
+          this->_offsets[vertex + 1] - this->_offsets[vertex]
+        );
+    }
+
+    // Check whether some triangle has the directed edge a to b, an edge
+    // without its twin lies on a border
+    bool has_edge(unsigned int a, unsigned int b) const
+    {
+      for (unsigned int triangle : this->around(a)) {
+        const unsigned int *corners = &this->_indices[3 * size_t(triangle)];
+        for (int k = 0; k < 3; ++k) {
+          if (corners[k] == a && corners[(k + 1) % 3] == b) {
+            return true;
+          }
+        }
+      }
+      return false;
+    }
+  };
+
+  glm::vec3 position(std::span<const float> vertices, unsigned int vertex)
+  {
+    const float *p = &vertices[3 * static_cast<size_t>(vertex)];
+    return glm::vec3(p[0], p[1], p[2]);
+  }
+
+  // Point every vertex at the first vertex with the same position, so
+  // seams between split vertices stay closed
+  std::vector<unsigned int> weld(std::span<const float> vertices)
+  {
+    size_t vertex_count = vertices.size() / 3;
+    std::vector<unsigned int> order(vertex_count);
+    std::iota(order.begin(), order.end(), 0);
+    auto compare = [&](unsigned int a, unsigned int b) {
+      return std::memcmp(
+        &vertices[3 * size_t(a)], &vertices[3 * size_t(b)], 3 * sizeof(float)
+      );
+    };
+    std::stable_sort(order.begin(), order.end(), [&](auto a, auto b) {
+      return compare(a, b) < 0;
+    });
+
+    std::vector<unsigned int> canonical(vertex_count);
+    for (size_t i = 0; i < vertex_count; ++i) {
+      bool same = i > 0 && compare(order[i - 1], order[i]) == 0;
+      canonical[order[i]] = same ? canonical[order[i - 1]] : order[i];
+    }
+    return canonical;
+  }
+
+  // Check whether moving a vertex turns any of its remaining triangles over
+  bool flips(
+    std::span<const float> vertices,
+    std::span<const unsigned int> indices,
+    std::span<const unsigned int> around,
+    unsigned int from,
+    unsigned int to
+  )
+  {
+    glm::vec3 target = position(vertices, to);
+    for (unsigned int triangle : around) {
+      const unsigned int *corners = &indices[3 * size_t(triangle)];
+      if (corners[0] == to || corners[1] == to || corners[2] == to) {
+        continue;
+      }
+
+      glm::vec3 p[3], q[3];
+      for (int k = 0; k < 3; ++k) {
+        p[k] = position(vertices, corners[k]);
+        q[k] = corners[k] == from ? target : p[k];
+      }
+      glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+      glm::vec3 after = glm::cross(q[1] - q[0], q[2] - q[0]);
+      if (glm::dot(before, after) <= 0.0f) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Greedy passes of independent collapses until the target is reached.
+  // Sets moved to the vertex each vertex ended up on and origin to the
+  // source triangle of each remaining triangle.
+  std::vector<unsigned int> collapse_edges(
+    std::span<const float> vertices,
+    std::span<const unsigned int> canonical,
+    std::span<const unsigned int> indices,
+    size_t target_count,
+    std::vector<unsigned int> &moved,
+    std::vector<unsigned int> &origin
+  )
+  {
+    size_t vertex_count = vertices.size() / 3;
+
+    // Work on the welded mesh without degenerate triangles
+    moved.assign(canonical.begin(), canonical.end());
+    origin.clear();
+    std::vector<unsigned int> result;
+    result.reserve(indices.size());
+    for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+      unsigned int a = canonical[indices[t]];
+      unsigned int b = canonical[indices[t + 1]];
+      unsigned int c = canonical[indices[t + 2]];
+      if (a != b && b != c && c != a) {
+        result.insert(result.end(), {a, b, c});
+        origin.push_back(static_cast<unsigned int>(t / 3));
+      }
+    }
+
+    // Face planes weighted by area, plus planes at right angles to the faces
+    // along borders
+    Adjacency adjacency;
+    adjacency.build(result, vertex_count);
+    std::vector<Quadric> quadrics(vertex_count);
+    for (size_t t = 0; t < result.size(); t += 3) {
+      glm::vec3 p[3];
+      for (int k = 0; k < 3; ++k) {
+        p[k] = position(vertices, result[t + k]);
+      }
+      glm::vec3 normal = glm::cross(p[1] - p[0], p[2] - p[0]);
+      float area = glm::length(normal);
+      if (area <= 0.0f) {
+        continue;
+      }
+      normal /= area;
+
+      Quadric face;
+      face.add_plane(normal, -glm::dot(normal, p[0]), 0.5 * area);
+      for (int k = 0; k < 3; ++k) {
+        quadrics[result[t + k]] += face;
+
+        unsigned int a = result[t + k];
+        unsigned int b = result[t + (k + 1) % 3];
+        if (!adjacency.has_edge(b, a)) {
+          glm::vec3 edge = p[(k + 1) % 3] - p[k];
+          glm::vec3 side = glm::cross(edge, normal);
+          float length = glm::length(side);
+          if (length > 0.0f) {
+            side /= length;
+            Quadric border;
+            border.add_plane(
+              side, -glm::dot(side, p[k]), BORDER_WEIGHT * length * length
+            );
+            quadrics[a] += border;
+            quadrics[b] += border;
+          }
+        }
+      }
+    }
+
+    std::vector<bool> on_border(vertex_count);
+    std::vector<bool> locked(vertex_count);
+    std::vector<unsigned int> remap(vertex_count);
+    std::vector<Collapse> collapses;
+
+    for (int pass = 0; pass < MAX_PASSES; ++pass) {
+      size_t triangle_count = result.size() / 3;
+      if (triangle_count <= target_count + target_count / TARGET_SLACK) {
+        break;
+      }
+
+      if (pass > 0) {
+        adjacency.build(result, vertex_count);
+      }
+      std::fill(on_border.begin(), on_border.end(), false);
+      for (size_t t = 0; t < result.size(); t += 3) {
+        for (int k = 0; k < 3; ++k) {
+          unsigned int a = result[t + k];
+          unsigned int b = result[t + (k + 1) % 3];
+          if (!adjacency.has_edge(b, a)) {
+            on_border[a] = on_border[b] = true;
+          }
+        }
+      }
+
+      // Cheapest way to collapse each edge. Border vertices may only slide
+      // along the border.
+      collapses.clear();
+      for (size_t t = 0; t < result.size(); t += 3) {
+        for (int k = 0; k < 3; ++k) {
+          unsigned int a = result[t + k];
+          unsigned int b = result[t + (k + 1) % 3];
+          bool border = !adjacency.has_edge(b, a);
+          if (a > b && !border) {
+            continue;
+          }
+
+          Collapse best{0, 0, -1.0};
+          for (auto [from, to] : {std::pair{a, b}, std::pair{b, a}}) {
+            if (on_border[from] && !border) {
+              continue;
+            }
+            Quadric merged = quadrics[from];
+            merged += quadrics[to];
+            double cost = merged.error(position(vertices, to));
+            if (best.error < 0 || cost < best.error) {
+              best = {from, to, cost};
+            }
+          }
+          if (best.error >= 0) {
+            collapses.push_back(best);
+          }
+        }
+      }
+      std::sort(collapses.begin(), collapses.end(), [](auto &x, auto &y) {
+        return x.error < y.error;
+      });
+
+      // Collapse edges cheapest first. Each collapse locks the triangles it
+      // touches for the rest of the pass, so collapses never interact.
+      std::iota(remap.begin(), remap.end(), 0);
+      std::fill(locked.begin(), locked.end(), false);
+      size_t goal = std::max<size_t>(1, (triangle_count - target_count) / 2);
+      size_t applied = 0;
+      for (const Collapse &collapse : collapses) {
+        if (applied == goal) {
+          break;
+        }
+        if (locked[collapse.from] || locked[collapse.to]) {
+          continue;
+        }
+
+        std::span<const unsigned int> around = adjacency.around(collapse.from);
+        if (flips(vertices, result, around, collapse.from, collapse.to)) {
+          continue;
+        }
+
+        for (unsigned int triangle : around) {
+          for (int k = 0; k < 3; ++k) {
+            locked[result[3 * size_t(triangle) + k]] = true;
+          }
+        }
+        remap[collapse.from] = collapse.to;
+        quadrics[collapse.to] += quadrics[collapse.from];
+        ++applied;
+      }
+      if (applied == 0) {
+        break;
+      }
+
+      // Apply the collapses and drop the triangles they closed up
+      size_t kept = 0;
+      for (size_t t = 0; t < result.size(); t += 3) {
+        unsigned int a = remap[result[t]];
+        unsigned int b = remap[result[t + 1]];
+        unsigned int c = remap[result[t + 2]];
+        if (a != b && b != c && c != a) {
+          origin[kept / 3] = origin[t / 3];
+          result[kept++] = a;
+          result[kept++] = b;
+          result[kept++] = c;
+        }
+      }
+      result.resize(kept);
+      origin.resize(kept / 3);
+      for (unsigned int &vertex : moved) {
+        vertex = remap[vertex];
+      }
+    }
+
+    return result;
+  }
+
+  // Farthest any vertex drawn by the indices was moved. Every remaining
+  // triangle is one of the originals with its corners moved, so no point
+  // of either mesh is farther than this from the other.
+  float farthest_move(
+    std::span<const float> vertices,
+    std::span<const unsigned int> indices,
+    std::span<const unsigned int> moved
+  )
+  {
+    float farthest = 0.0f;
+    for (unsigned int v : indices) {
+      farthest = std::max(
+        farthest,
+        glm::distance(position(vertices, v), position(vertices, moved[v]))
+      );
+    }
+    return farthest;
+  }
+
+  // Point each corner of the welded result at the split vertex of its
+  // position whose attributes are closest to those of the corner it came
+  // from, so hard edges and texture seams keep their own normals and UVs
+  void restore_corners(
+    std::span<const std::span<const float>> attributes,
+    std::span<const unsigned int> canonical,
+    std::span<const unsigned int> indices,
+    std::span<const unsigned int> origin,
+    std::vector<unsigned int> &result
+  )
+  {
+    // Vertices sharing each welded position, as ranges of one flat list
+    size_t vertex_count = canonical.size();
+    std::vector<size_t> offsets(vertex_count + 1, 0);
+    for (unsigned int welded : canonical) {
+      ++offsets[welded + 1];
+    }
+    std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+    std::vector<unsigned int> splits(vertex_count);
+    std::vector<size_t> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t v = 0; v < vertex_count; ++v) {
+      splits[fill[canonical[v]]++] = static_cast<unsigned int>(v);
+    }
+
+    auto difference = [&](unsigned int a, unsigned int b) {
+      double sum = 0;
+      for (std::span<const float> stream : attributes) {
+        size_t components = stream.size() / vertex_count;
+        for (size_t i = 0; i < components; ++i) {
+          double d = stream[a * components + i] - stream[b * components + i];
+          sum += d * d;
+        }
+      }
+      return sum;
+    };
+
+    for (size_t i = 0; i < result.size(); ++i) {
+      unsigned int corner = indices[3 * size_t(origin[i / 3]) + i % 3];
+      unsigned int welded = result[i];
+      if (canonical[corner] == welded) {
+        result[i] = corner;
+        continue;
+      }
+
+      unsigned int best = welded;
+      double best_difference = difference(corner, welded);
+      for (size_t s = offsets[welded]; s < offsets[welded + 1]; ++s) {
+        double d = difference(corner, splits[s]);
+        if (d < best_difference) {
+          best = splits[s];
+          best_difference = d;
+        }
+      }
+      result[i] = best;
+    }
+  }
+}  // namespace
+
+// -------- Static Functions -------- //
+std::vector<unsigned int> Mesh_simplifier::simplify(
+  std::span<const float> vertices,
+  std::span<const unsigned int> indices,
+  size_t target_count,
+  float &error,
+  std::span<const std::span<const float>> attributes
+)
+{
+  std::vector<unsigned int> canonical = weld(vertices);
+  std::vector<unsigned int> moved, origin;
+  std::vector<unsigned int> result = collapse_edges(
+    vertices, canonical, indices, target_count, moved, origin
+  );
+  error = farthest_move(vertices, indices, moved);
+  restore_corners(attributes, canonical, indices, origin, result);
+  return result;
+}
+
+// Simplify each level from the one before and append it to the indices
+std::vector<Mesh_lod> Mesh_simplifier::build_lods(
+  std::span<const float> vertices,
+  std::vector<unsigned int> &indices,
+  std::span<const float> ratios,
+  std::span<const std::span<const float>> attributes
+)
+{
+  std::vector<Mesh_lod> lods{{0, static_cast<uint32_t>(indices.size()), 0}};
+  size_t full_count = indices.size() / 3;
+  std::vector<unsigned int> source(indices);
+
+  // Vertex of the current level each vertex of the full mesh ended up on
+  std::vector<unsigned int> owner(vertices.size() / 3);
+  std::iota(owner.begin(), owner.end(), 0);
+  std::vector<unsigned int> canonical = weld(vertices);
+  std::vector<unsigned int> moved, origin;
+
+  for (float ratio : ratios) {
+    size_t target = static_cast<size_t>(full_count * ratio);
+    std::vector<unsigned int> level = collapse_edges(
+      vertices, canonical, source, target, moved, origin
+    );
+
+    // Stop once the mesh cannot get any simpler
+    if (level.empty() || level.size() >= source.size()) {
+      break;
+    }
+
+    // Measured against the full mesh, as errors of successive levels do
+    // not simply add up
+    for (unsigned int &vertex : owner) {
+      vertex = moved[vertex];
+    }
+    float error = farthest_move(
+      vertices, std::span(indices).first(lods[0].count), owner
+    );
+    restore_corners(attributes, canonical, source, origin, level);
+    lods.push_back({
+      static_cast<uint32_t>(indices.size()),
+      static_cast<uint32_t>(level.size()),
+      error
+    });
+    indices.insert(indices.end(), level.begin(), level.end());
+    source = std::move(level);
+  }
+
+  return lods;
+}
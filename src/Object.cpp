@@ -1,54 +1,431 @@
 #include "Object.h"
 
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+#include "MappedFile.h"
+#include "MeshOptimizer.h"
+#include "MeshPacker.h"
+#include "MeshSimplifier.h"
+#include "PlyImporter.h"
+#include "WavefrontImporter.h"
+
+namespace {
+  using Clock = std::chrono::steady_clock;
+
+  // Seconds elapsed since a point in time
+  double seconds_since(Clock::time_point start)
+  {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+  }
+
+  // Whitespace as skipped by the stream extraction operators
+  bool is_space(char c)
+  {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' ||
+           c == '\r';
+  }
+
+  // Whitespace trimmed from either end of a line
+  bool is_blank(char c)
+  {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+  }
+
+  // Triples of numbers a declared count may reserve room for. Each takes
+  // at least six characters, three digits and their separators.
+  size_t max_triples(int count, std::string_view text)
+  {
+    return std::min<size_t>(count, text.size() / 6);
+  }
+
+  // Tokenizer over a spec file held in memory
+  class Conf_reader
+  {
+    const char *_cur;
+    const char *_end;
+    const std::string &_path;
+
+  public:
+    Conf_reader(std::string_view text, const std::string &path) :
+      _cur(text.data()), _end(text.data() + text.size()), _path(path)
+    {}
+
+    // Return the next non-empty, non-comment line starting at the cursor
+    // and move the cursor past it
+    bool next_line(std::string_view &line)
+    {
+      while (this->_cur < this->_end) {
+        const char *eol = static_cast<const char *>(
+          std::memchr(this->_cur, '\n', this->_end - this->_cur)
+        );
+        const char *stop = eol ? eol : this->_end;
+
+        // Trim whitespace
+        const char *first = this->_cur;
+        const char *last = stop;
+        while (first < last && is_blank(*first)) {
+          ++first;
+        }
+        while (last > first && is_blank(*(last - 1))) {
+          --last;
+        }
+
+        this->_cur = eol ? eol + 1 : this->_end;
+        if (first != last && *first != '#') {
+          line = std::string_view(first, last - first);
+          return true;
+        }
+      }
+      return false;
+    }
+
+    // Split the first word off a line
+    static std::string_view word(std::string_view &line)
+    {
+      size_t start = 0;
+      while (start < line.size() && is_space(line[start])) {
+        ++start;
+      }
+      size_t stop = start;
+      while (stop < line.size() && !is_space(line[stop])) {
+        ++stop;
+      }
+      std::string_view token = line.substr(start, stop - start);
+      line.remove_prefix(stop);
+      return token;
+    }
+
+    // Parse a number from the front of a line
+    template <typename T>
+    T number(std::string_view &line) const
+    {
+      const char *first = line.data();
+      const char *last = first + line.size();
+      T value = this->parse<T>(first, last);
+      line.remove_prefix(first - line.data());
+      return value;
+    }
+
+    // Parse a number at the cursor, crossing line breaks like operator>>
+    template <typename T>
+    T number()
+    {
+      return this->parse<T>(this->_cur, this->_end);
+    }
+
+  private:
+    template <typename T>
+    T parse(const char *&first, const char *last) const
+    {
+      while (first < last && is_space(*first)) {
+        ++first;
+      }
+      // from_chars does not accept an explicit plus sign
+      if (first < last && *first == '+') {
+        ++first;
+      }
+
+      T value{};
+      auto [ptr, err] = std::from_chars(first, last, value);
+      if (err != std::errc() || ptr == first) {
+        throw std::runtime_error("Malformed number in file: " + this->_path);
+      }
+      first = ptr;
+      return value;
+    }
+  };
+}  // namespace
+
 // Object Spec functions
 // ---------------------
-Object::Obj_spec::Obj_spec(const std::string &filepath)
+Object::Obj_spec::Obj_spec(
+  const std::string &filepath, const Load_options &options
+) :
+  colour(glm::vec3(1.0f)), source_hash(0), index_type(GL_UNSIGNED_INT)
 {
-  std::cout << "Reading file " << filepath << std::endl;
+  // Use the compiled cache when it is still valid for the source
+  auto start = Clock::now();
+  uint32_t key = options.key();
+  this->_cache = Mesh_cache::open(filepath, key);
+  if (this->_cache) {
+    this->colour = this->_cache->colour();
+    this->source_hash = this->_cache->source_hash();
+    this->timings.parse = seconds_since(start);
+    std::cout << "Reading cache " << Mesh_cache::cache_path(filepath, key)
+              << '\n';
+  }
+  else {
+    this->compile(filepath, options);
+  }
+
+  start = Clock::now();
+  this->pack(filepath, options);
+  this->timings.pack = seconds_since(start);
+}
+
+std::span<const float> Object::Obj_spec::vertex_data() const
+{
+  return this->_cache ? this->_cache->vertices() : this->vertices;
+}
+
+std::span<const unsigned int> Object::Obj_spec::index_data() const
+{
+  return this->_cache ? this->_cache->indices() : this->indices;
+}
+
+std::span<const Mesh_lod> Object::Obj_spec::lod_data() const
+{
+  return this->_cache ? this->_cache->lods() : this->lods;
+}
+
+Vertex_streams Object::Obj_spec::stream_data() const
+{
+  if (this->_cache) {
+    return this->_cache->streams();
+  }
+  return {this->vertices, this->normals, this->uvs, this->colours};
+}
+
+std::span<const std::byte> Object::Obj_spec::vertex_bytes() const
+{
+  if (this->_packed_vertices.empty()) {
+    return std::as_bytes(this->vertex_data());
+  }
+  return this->_packed_vertices;
+}
+
+std::span<const std::byte> Object::Obj_spec::index_bytes() const
+{
+  if (this->index_type == GL_UNSIGNED_INT) {
+    return std::as_bytes(this->index_data());
+  }
+  return this->_packed_indices;
+}
+
+// Parse the source and process it as the options ask
+void Object::Obj_spec::compile(
+  const std::string &filepath, const Load_options &options
+)
+{
+  // Stamp the source before it is read, so the cache never pairs a newer
+  // stamp with older geometry
+  Mesh_cache::Stamp stamp{};
+  bool stamped = Mesh_cache::stamp(filepath, stamp);
 
-  std::ifstream infile(filepath);
-  if (!infile.is_open()) {
-    throw std::runtime_error("Cannot open file: " + filepath);
+  // Pick a parser by file type
+  auto start = Clock::now();
+  if (Wavefront_importer::handles(filepath)) {
+    Wavefront_importer importer(filepath);
+    this->vertices = std::move(importer.vertices);
+    this->indices = std::move(importer.indices);
+    this->normals = std::move(importer.normals);
+    this->uvs = std::move(importer.uvs);
+    stamp.hash = importer.source_hash;
+  }
+  else if (Ply_importer::handles(filepath)) {
+    Ply_importer importer(filepath);
+    this->vertices = std::move(importer.vertices);
+    this->indices = std::move(importer.indices);
+    stamp.hash = importer.source_hash;
   }
+  else {
+    Mapped_file file(filepath);
+    this->parse(filepath, file.view());
+    stamp.hash = Mesh_cache::content_hash(file.view());
+  }
+  this->source_hash = stamp.hash;
+  this->timings.parse = seconds_since(start);
+
+  start = Clock::now();
+  this->validate(filepath);
+  this->timings.validate = seconds_since(start);
 
-  std::string line;
-  while (std::getline(infile, line)) {
-    // Skip whitespace and comments
-    line.erase(0, line.find_first_not_of(" \t\r\n"));
-    line.erase(line.find_last_not_of(" \t\r\n") + 1);
-    if (line.empty() || line[0] == '#') {
-      continue;
+  start = Clock::now();
+  if (options.optimize) {
+    std::vector<unsigned int> remap =
+      Mesh_optimizer::optimize(filepath, this->vertices, this->indices);
+    if (!remap.empty()) {
+      Mesh_optimizer::remap_attribute(remap, 3, this->normals);
+      Mesh_optimizer::remap_attribute(remap, 2, this->uvs);
+      Mesh_optimizer::remap_attribute(remap, 4, this->colours);
     }
+  }
+  this->build_lods(filepath, options);
+  this->timings.prepare = seconds_since(start);
 
+  // Failing to write the cache only costs the next load a parse
+  start = Clock::now();
+  try {
+    if (!stamped) {
+      throw std::runtime_error("Cannot stat file: " + filepath);
+    }
+    Mesh_cache::write(
+      filepath,
+      stamp,
+      this->stream_data(),
+      this->indices,
+      this->lods,
+      this->colour,
+      options.key()
+    );
+  } catch (const std::exception &err) {
+    std::cerr << err.what() << '\n';
+  }
+  this->timings.cache = seconds_since(start);
+}
+
+// Check element counts, index ranges and coordinates
+void Object::Obj_spec::validate(const std::string &filepath) const
+{
+  if (this->vertices.size() % 3 != 0 || this->indices.size() % 3 != 0) {
+    throw std::runtime_error("Incomplete vertex or triangle in " + filepath);
+  }
+
+  size_t vertex_count = this->vertices.size() / 3;
+  unsigned int max = 0;
+  for (unsigned int index : this->indices) {
+    max = std::max(max, index);
+  }
+  if (!this->indices.empty() && max >= vertex_count) {
+    throw std::runtime_error("Index out of range in file: " + filepath);
+  }
+
+  for (float coord : this->vertices) {
+    if (!std::isfinite(coord)) {
+      throw std::runtime_error("Non-finite vertex in file: " + filepath);
+    }
+  }
+
+  // Attributes are per vertex, or absent
+  bool complete = (this->normals.empty() ||
+                   this->normals.size() == 3 * vertex_count) &&
+                  (this->uvs.empty() || this->uvs.size() == 2 * vertex_count) &&
+                  (this->colours.empty() ||
+                   this->colours.size() == 4 * vertex_count);
+  if (!complete) {
+    throw std::runtime_error("Incomplete vertex attribute in " + filepath);
+  }
+}
+
+// Lay the data out for upload, leaving it in place when nothing changes
+void Object::Obj_spec::pack(
+  const std::string &filepath, const Load_options &options
+)
+{
+  Vertex_streams streams = this->stream_data();
+  std::span<const unsigned int> elements = this->index_data();
+
+  this->index_type = Mesh_packer::index_type(elements);
+  if (this->index_type != GL_UNSIGNED_INT) {
+    this->_packed_indices =
+      Mesh_packer::pack_indices(elements, this->index_type);
+  }
+  bool attributes = !streams.normals.empty() || !streams.uvs.empty() ||
+                    !streams.colours.empty();
+  if (options.quantize || attributes) {
+    this->_packed_vertices =
+      Mesh_packer::interleave(streams, options.quantize, this->format);
+  }
+
+  size_t before = streams.positions.size_bytes() +
+                  streams.normals.size_bytes() + streams.uvs.size_bytes() +
+                  streams.colours.size_bytes() + elements.size_bytes();
+  size_t after = this->vertex_bytes().size() + this->index_bytes().size();
+  if (after != before) {
+    std::cout << "Packed " << filepath << " from " << before << " to "
+              << after << " bytes\n";
+  }
+}
+
+void Object::Obj_spec::build_lods(
+  const std::string &filepath, const Load_options &options
+)
+{
+  if (options.lod_ratios.empty()) {
+    this->lods = {{0, static_cast<uint32_t>(this->indices.size()), 0}};
+    return;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  std::span<const float> attributes[] = {
+    this->normals, this->uvs, this->colours
+  };
+  this->lods = Mesh_simplifier::build_lods(
+    this->vertices, this->indices, options.lod_ratios, attributes
+  );
+
+  // Simplified levels get the same cache ordering as the full mesh
+  for (size_t i = 1; options.optimize && i < this->lods.size(); ++i) {
+    auto level = std::span(this->indices).subspan(
+      this->lods[i].first, this->lods[i].count
+    );
+    std::vector<size_t> clusters;
+    std::vector<unsigned int> ordered = Mesh_optimizer::optimize_vertex_cache(
+      level, this->vertices.size() / 3, clusters
+    );
+    std::copy(ordered.begin(), ordered.end(), level.begin());
+  }
+
+  std::chrono::duration<double, std::milli> elapsed =
+    std::chrono::steady_clock::now() - start;
+  std::cout << "Built " << this->lods.size() - 1 << " levels of detail for "
+            << filepath << " in " << elapsed.count() << " ms:";
+  for (const Mesh_lod &lod : this->lods) {
+    std::cout << ' ' << lod.count / 3 << " (" << lod.error << ')';
+  }
+  std::cout << '\n';
+}
+
+void Object::Obj_spec::parse(const std::string &filepath, std::string_view text)
+{
+  auto start = std::chrono::steady_clock::now();
+
+  Conf_reader reader(text, filepath);
+
+  std::string_view line;
+  while (reader.next_line(line)) {
     // Get keyword
-    std::stringstream ss(line);
-    std::string keyword;
-    ss >> keyword;
+    std::string_view keyword = Conf_reader::word(line);
 
     // Read vertices
     if (keyword == "verts") {
-      int count;
-      ss >> count;
+      int count = reader.number<int>(line);
+      if (count < 0) {
+        throw std::runtime_error("Negative vertex count in file: " + filepath);
+      }
+      // A damaged count fails in the tokenizer, not in a huge allocation
+      vertices.reserve(vertices.size() + 3 * max_triples(count, text));
       for (int i = 0; i < count; ++i) {
-        float x, y, z;
-        infile >> x >> y >> z;
+        float x = reader.number<float>();
+        float y = reader.number<float>();
+        float z = reader.number<float>();
         vertices.insert(vertices.end(), {x, y, z});
       }
     }
     // Read indices
     else if (keyword == "indices") {
-      int count;
-      ss >> count;
+      int count = reader.number<int>(line);
+      if (count < 0) {
+        throw std::runtime_error("Negative index count in file: " + filepath);
+      }
+      indices.reserve(indices.size() + 3 * max_triples(count, text));
       for (int i = 0; i < count; ++i) {
-        unsigned int a, b, c;
-        infile >> a >> b >> c;
+        unsigned int a = reader.number<unsigned int>();
+        unsigned int b = reader.number<unsigned int>();
+        unsigned int c = reader.number<unsigned int>();
         indices.insert(indices.end(), {a, b, c});
       }
     }
     // Read colour
     else if (keyword == "colour") {
-      float r, g, b;
-      ss >> r >> g >> b;
+      float r = reader.number<float>(line);
+      float g = reader.number<float>(line);
+      float b = reader.number<float>(line);
       colour = glm::vec3(r, g, b);
     }
     // Report error
@@ -57,33 +434,71 @@ Object::Obj_spec::Obj_spec(const std::string &filepath)
     }
   }
 
-  infile.close();
+  // Report parsing throughput
+  std::chrono::duration<double> elapsed =
+    std::chrono::steady_clock::now() - start;
+  double mbps = text.size() / (1024.0 * 1024.0) / elapsed.count();
+  std::cout << "Reading file " << filepath << " (" << text.size()
+            << " bytes, " << mbps << " MB/s)\n";
 }
 
 // Object Functions
 // ----------------
 // Constructor
-Object::Object(const std::string &filepath) : Object(Obj_spec(filepath))
+Object::Object(std::shared_ptr<Mesh> mesh) :
+  _mesh(std::move(mesh)), _opacity(1.0f), _transform(glm::mat4(1.0f))
 {}
 
-// Destructor
-Object::~Object()
+// Constructor
+Object::Object(const std::string &filepath, const Load_options &options) :
+  Object(std::make_shared<Mesh>())
+{
+  Obj_spec spec(filepath, options);
+  this->_mesh->load_object(
+    spec.vertex_bytes(),
+    spec.index_bytes(),
+    spec.index_type,
+    spec.format,
+    spec.colour,
+    spec.lod_data()
+  );
+}
+
+// Compare the error of each level with the distance, in mesh units
+size_t Object::lod(glm::vec3 eye, float projection, float pixel_error) const
 {
-  glDeleteBuffers(1, &(this->EBO));
-  glDeleteBuffers(1, &(this->VBO));
-  glDeleteVertexArrays(1, &(this->VAO));
+  float scale = std::max({
+    glm::length(glm::vec3(this->_transform[0])),
+    glm::length(glm::vec3(this->_transform[1])),
+    glm::length(glm::vec3(this->_transform[2]))
+  });
+  if (scale <= 0.0f) {
+    return 0;
+  }
+
+  float distance = glm::length(eye - glm::vec3(this->_transform[3]));
+  return this->_mesh->pick_lod(distance / scale, projection, pixel_error);
 }
 
-// Draw object once loaded
-void Object::draw(Shader &shader)
+// Gather the instance attribute values
+Instance Object::instance() const
 {
-  // Link shader and load values
-  shader.set_vec3("objColour", this->_colour);
-  shader.set_mat4("model", this->_transform);
+  return {
+    this->_transform,
+    glm::vec4(this->_colour.value_or(this->_mesh->colour()), this->_opacity)
+  };
+}
 
-  // Draw object
-  glBindVertexArray(this->VAO);
-  glDrawElements(GL_TRIANGLES, this->index_count, GL_UNSIGNED_INT, 0);
+// Override the mesh colour
+void Object::set_colour(glm::vec3 colour)
+{
+  this->_colour = colour;
+}
+
+// Clamped so blending stays in range
+void Object::set_opacity(float opacity)
+{
+  this->_opacity = std::clamp(opacity, 0.0f, 1.0f);
 }
 
 // Move the object to new position
@@ -104,46 +519,3 @@ void Object::rotate(glm::vec3 axis, float angle)
   axis = glm::normalize(axis);
   this->_transform = glm::rotate(this->_transform, glm::radians(angle), axis);
 }
-
-// -------- Private Functions -------- //
-// Constructor
-Object::Object(const Obj_spec &spec) :
-  _colour(spec.colour), _transform(glm::mat4(1.0f))
-{
-  this->load_object(spec.vertices, spec.indices);
-}
-
-void Object::load_object(const Vertices &vertices, const Indices &indices)
-{
-  // Record array sizes for later use
-  this->index_count = indices.size();
-  this->vertex_count = vertices.size();
-
-  //Generate buffers and vertex arrays
-  glGenVertexArrays(1, &(this->VAO));
-  glGenBuffers(1, &(this->VBO));
-  glGenBuffers(1, &(this->EBO));
-
-  // Bind buffers and vertex arrays
-  glBindVertexArray(this->VAO);
-  glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->EBO);
-
-  // Push data into buffers
-  glBufferData(
-    GL_ARRAY_BUFFER,
-    this->vertex_count * sizeof(float),
-    vertices.data(),
-    GL_STATIC_DRAW
-  );
-  glBufferData(
-    GL_ELEMENT_ARRAY_BUFFER,
-    indices.size() * sizeof(unsigned int),
-    indices.data(),
-    GL_STATIC_DRAW
-  );
-
-  // Set and enable Vertex pointers
-  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void *)0);
-  glEnableVertexAttribArray(0);
-}
@@ -0,0 +1,391 @@
+#include "PlyImporter.h"
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#include "MappedFile.h"
+#include "MeshCache.h"
+
+#ifdef __SSE2__
+#  include <emmintrin.h>
+#endif
+
+namespace {
+  template <typename T>
+  T load(const char *data)
+  {
+    T value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+  }
+}  // namespace
+
+// Constructor
+Ply_importer::Ply_importer(const std::string &filepath) :
+  _path(filepath), source_hash(0)
+{
+  auto start = std::chrono::steady_clock::now();
+
+  Mapped_file file(filepath);
+  this->source_hash = Mesh_cache::content_hash(file.view());
+  const char *data = file.data() + this->read_header(file.view());
+  const char *end = file.data() + file.size();
+
+  // Elements are stored back to back in header order
+  for (const Element &element : this->_elements) {
+    if (element.name == "vertex") {
+      data = this->read_vertices(element, data, end);
+    }
+    else if (element.name == "face") {
+      data = this->read_faces(element, data, end);
+    }
+    else {
+      data = this->skip_element(element, data, end);
+    }
+  }
+
+  // Report parsing throughput
+  std::chrono::duration<double> elapsed =
+    std::chrono::steady_clock::now() - start;
+  double mbps = file.size() / (1024.0 * 1024.0) / elapsed.count();
+  std::cout << "Reading file " << filepath << " (" << file.size()
+            << " bytes, " << mbps << " MB/s)\n";
+}
+
+// Check the file extension
+bool Ply_importer::handles(const std::string &filepath)
+{
+  return filepath.size() > 4 &&
+         filepath.compare(filepath.size() - 4, 4, ".ply") == 0;
+}
+
+// -------- Private Functions -------- //
+namespace {
+  size_t type_size(int type)
+  {
+    static const size_t sizes[] = {1, 1, 2, 2, 4, 4, 4, 8};
+    return sizes[type];
+  }
+
+  // Read a scalar of any PLY type
+  double read_value(int type, const char *data)
+  {
+    switch (type) {
+    case 0: return load<int8_t>(data);
+    case 1: return load<uint8_t>(data);
+    case 2: return load<int16_t>(data);
+    case 3: return load<uint16_t>(data);
+    case 4: return load<int32_t>(data);
+    case 5: return load<uint32_t>(data);
+    case 6: return load<float>(data);
+    default: return load<double>(data);
+    }
+  }
+
+  // Read the length of a list, which must be a whole number no larger than
+  // the widest integer count type allows
+  bool read_count(int type, const char *data, size_t &count)
+  {
+    double value = read_value(type, data);
+    if (!(value >= 0.0 && value <= UINT32_MAX) || value != std::floor(value)) {
+      return false;
+    }
+    count = static_cast<size_t>(value);
+    return true;
+  }
+}  // namespace
+
+// Parse element and property declarations
+size_t Ply_importer::read_header(std::string_view text)
+{
+  static const char *const type_names[][2] = {
+    {"char", "int8"},
+    {"uchar", "uint8"},
+    {"short", "int16"},
+    {"ushort", "uint16"},
+    {"int", "int32"},
+    {"uint", "uint32"},
+    {"float", "float32"},
+    {"double", "float64"},
+  };
+  auto parse_type = [this](const std::string &name) {
+    for (int i = 0; i < 8; ++i) {
+      if (name == type_names[i][0] || name == type_names[i][1]) {
+        return static_cast<Ply_type>(i);
+      }
+    }
+    throw std::runtime_error("Unknown PLY type in file: " + this->_path);
+  };
+
+  size_t end = text.find("end_header");
+  if (text.substr(0, 3) != "ply" || end == std::string_view::npos) {
+    throw std::runtime_error("Not a PLY file: " + this->_path);
+  }
+  std::istringstream header(std::string(text.substr(0, end)));
+  size_t body = text.find('\n', end);
+  if (body == std::string_view::npos) {
+    throw std::runtime_error("Truncated PLY header in file: " + this->_path);
+  }
+
+  bool binary = false;
+  std::string line;
+  while (std::getline(header, line)) {
+    std::istringstream ss(line);
+    std::string keyword;
+    ss >> keyword;
+
+    if (keyword == "format") {
+      std::string format;
+      ss >> format;
+      binary = format == "binary_little_endian";
+    }
+    else if (keyword == "element") {
+      Element element;
+      ss >> element.name >> element.count;
+      this->_elements.push_back(element);
+    }
+    else if (keyword == "property") {
+      if (this->_elements.empty()) {
+        throw std::runtime_error("Property outside element in: " + this->_path);
+      }
+      Property property{};
+      std::string type;
+      ss >> type;
+      if (type == "list") {
+        std::string count_type;
+        ss >> count_type >> type;
+        property.is_list = true;
+        property.count_type = parse_type(count_type);
+      }
+      property.type = parse_type(type);
+      ss >> property.name;
+      this->_elements.back().properties.push_back(property);
+    }
+  }
+
+  if (!binary) {
+    throw std::runtime_error(
+      "PLY file is not little-endian binary: " + this->_path
+    );
+  }
+
+  return body + 1;
+}
+
+// Read x, y and z of every vertex as floats
+const char *Ply_importer::read_vertices(
+  const Element &element, const char *data, const char *end
+)
+{
+  // Fixed-size rows are required to locate the position properties
+  size_t stride = 0;
+  size_t offset[3] = {SIZE_MAX, SIZE_MAX, SIZE_MAX};
+  int type[3] = {FLOAT, FLOAT, FLOAT};
+  for (const Property &property : element.properties) {
+    if (property.is_list) {
+      throw std::runtime_error("Unsupported vertex list in: " + this->_path);
+    }
+    for (int k = 0; k < 3; ++k) {
+      if (property.name == std::string(1, static_cast<char>('x' + k))) {
+        offset[k] = stride;
+        type[k] = property.type;
+      }
+    }
+    stride += type_size(property.type);
+  }
+  if (offset[0] == SIZE_MAX || offset[1] == SIZE_MAX || offset[2] == SIZE_MAX) {
+    throw std::runtime_error("Vertex without position in: " + this->_path);
+  }
+
+  size_t count = element.count;
+  if (count > static_cast<size_t>(end - data) / stride) {
+    throw std::runtime_error("Truncated vertex data in: " + this->_path);
+  }
+
+  // One float of slack for the overlapping 16 byte stores below
+  size_t first = this->vertices.size();
+  this->vertices.resize(first + 3 * count + 1);
+  float *out = this->vertices.data() + first;
+
+  bool packed = type[0] == FLOAT && type[1] == FLOAT && type[2] == FLOAT &&
+                offset[1] == offset[0] + 4 && offset[2] == offset[0] + 8;
+  size_t done = 0;
+
+  // Positions only, the body is already in the output layout
+  if (packed && stride == 3 * sizeof(float)) {
+    std::memcpy(out, data, count * stride);
+    done = count;
+  }
+#ifdef __SSE2__
+  // Interleaved float positions, copy xyz plus one junk lane per row. The
+  // last row is left to the scalar loop so the load never leaves the file.
+  else if (packed) {
+    const char *row = data + offset[0];
+    for (; done + 1 < count; ++done, row += stride) {
+      auto *src = reinterpret_cast<const float *>(row);
+      _mm_storeu_ps(out + 3 * done, _mm_loadu_ps(src));
+    }
+  }
+#endif
+
+  // Remaining rows, converting from any scalar type
+  for (; done < count; ++done) {
+    const char *row = data + done * stride;
+    for (int k = 0; k < 3; ++k) {
+      out[3 * done + k] = read_value(type[k], row + offset[k]);
+    }
+  }
+
+  this->vertices.resize(first + 3 * count);
+  return data + count * stride;
+}
+
+// Read faces as triangles
+const char *Ply_importer::read_faces(
+  const Element &element, const char *data, const char *end
+)
+{
+  // Indices must refer to a declared vertex
+  size_t limit = 0;
+  for (const Element &other : this->_elements) {
+    if (other.name == "vertex") {
+      limit = other.count;
+    }
+  }
+
+  // Point clouds often declare an empty face element with no properties
+  size_t count = element.count;
+  if (count == 0) {
+    return data;
+  }
+  bool has_list = std::any_of(
+    element.properties.begin(),
+    element.properties.end(),
+    [](const Property &property) { return property.is_list; }
+  );
+  if (!has_list) {
+    throw std::runtime_error("Face without index list in: " + this->_path);
+  }
+
+  size_t done = 0;
+  const Property &first = element.properties.front();
+
+#ifdef __SSE2__
+  // A single uchar-counted int list: rows are 13 bytes and, for triangles,
+  // copying 16 bytes from after the count moves all three indices at once
+  bool triangles = element.properties.size() == 1 && first.is_list &&
+                   (first.name == "vertex_indices" ||
+                    first.name == "vertex_index") &&
+                   first.count_type == UCHAR &&
+                   (first.type == INT || first.type == UINT);
+  if (triangles && limit <= INT_MAX) {
+    size_t rows = std::min<size_t>(count, (end - data) / 13);
+    size_t start = this->indices.size();
+    this->indices.resize(start + 3 * rows + 1);
+    unsigned int *out = this->indices.data() + start;
+
+    // Lanes holding indices outside [0, limit) end up set in bad. The last
+    // row is left to the scalar loop so the load never leaves the file.
+    const __m128i low = _mm_set1_epi32(0);
+    const __m128i high = _mm_set1_epi32(static_cast<int>(limit) - 1);
+    __m128i bad = _mm_setzero_si128();
+    const char *row = data;
+    for (; done + 1 < rows && *row == 3; ++done, row += 13) {
+      auto *src = reinterpret_cast<const __m128i *>(row + 1);
+      __m128i v = _mm_loadu_si128(src);
+      bad = _mm_or_si128(bad, _mm_cmplt_epi32(v, low));
+      bad = _mm_or_si128(bad, _mm_cmpgt_epi32(v, high));
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 3 * done), v);
+    }
+
+    // The fourth lane comes from the next row and is ignored
+    alignas(16) int lanes[4];
+    _mm_store_si128(reinterpret_cast<__m128i *>(lanes), bad);
+    if (lanes[0] | lanes[1] | lanes[2]) {
+      throw std::runtime_error("Face index out of range in: " + this->_path);
+    }
+
+    this->indices.resize(start + 3 * done);
+    data = row;
+  }
+#endif
+
+  // Remaining faces, any list types and polygon sizes
+  std::vector<unsigned int> polygon;
+  for (; done < count; ++done) {
+    for (const Property &property : element.properties) {
+      size_t items = 1;
+      if (property.is_list) {
+        if (static_cast<size_t>(end - data) < type_size(property.count_type)) {
+          throw std::runtime_error("Truncated face data in: " + this->_path);
+        }
+        if (!read_count(property.count_type, data, items)) {
+          throw std::runtime_error("Invalid list length in: " + this->_path);
+        }
+        data += type_size(property.count_type);
+      }
+      size_t size = items * type_size(property.type);
+      if (static_cast<size_t>(end - data) < size) {
+        throw std::runtime_error("Truncated face data in: " + this->_path);
+      }
+
+      if (property.is_list && (property.name == "vertex_indices" ||
+                               property.name == "vertex_index")) {
+        polygon.clear();
+        for (size_t i = 0; i < items; ++i) {
+          const char *item = data + i * type_size(property.type);
+          double index = read_value(property.type, item);
+          if (index < 0 || index >= limit) {
+            throw std::runtime_error(
+              "Face index out of range in: " + this->_path
+            );
+          }
+          polygon.push_back(static_cast<unsigned int>(index));
+        }
+        // Fan triangulation
+        for (size_t i = 1; i + 1 < items; ++i) {
+          this->indices.insert(
+            this->indices.end(), {polygon[0], polygon[i], polygon[i + 1]}
+          );
+        }
+      }
+      data += size;
+    }
+  }
+
+  return data;
+}
+
+// Step over an element without reading it
+const char *Ply_importer::skip_element(
+  const Element &element, const char *data, const char *end
+) const
+{
+  for (size_t row = 0; row < element.count; ++row) {
+    for (const Property &property : element.properties) {
+      size_t items = 1;
+      if (property.is_list) {
+        if (static_cast<size_t>(end - data) < type_size(property.count_type)) {
+          throw std::runtime_error("Truncated element in: " + this->_path);
+        }
+        if (!read_count(property.count_type, data, items)) {
+          throw std::runtime_error("Invalid list length in: " + this->_path);
+        }
+        data += type_size(property.count_type);
+      }
+      size_t size = items * type_size(property.type);
+      if (static_cast<size_t>(end - data) < size) {
+        throw std::runtime_error("Truncated element in: " + this->_path);
+      }
+      data += size;
+    }
+  }
+  return data;
+}
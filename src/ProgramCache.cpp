@@ -0,0 +1,165 @@
+#include "ProgramCache.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <unistd.h>
+#include <vector>
+
+#include "GlExtensions.h"
+#include "MeshCache.h"
+
+namespace {
+  constexpr char MAGIC[4] = {'P', 'R', 'G', 'B'};
+  constexpr uint32_t VERSION = 1;
+
+  // GL strings may be null on broken contexts
+  std::string gl_string(GLenum name)
+  {
+    const GLubyte *value = glGetString(name);
+    return value ? reinterpret_cast<const char *>(value) : "";
+  }
+}  // namespace
+
+// Constructor
+Program_cache::Program_cache(const std::string &dir) :
+  _dir(dir), _driver_hash(0), _enabled(false)
+{
+  if (!Gl_extensions::program_binary) {
+    return;
+  }
+  GLint formats = 0;
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+  if (formats <= 0) {
+    return;
+  }
+
+  std::error_code err;
+  std::filesystem::create_directories(dir, err);
+  if (err) {
+    std::cerr << "Cannot create shader cache " << dir << ": "
+              << err.message() << '\n';
+    return;
+  }
+
+  // Any driver update changes at least the version string
+  std::string driver = gl_string(GL_VENDOR) + '\n' + gl_string(GL_RENDERER) +
+                       '\n' + gl_string(GL_VERSION);
+  this->_driver_hash = Mesh_cache::content_hash(driver);
+  this->_enabled = true;
+}
+
+// Both stages go into one hash, separated so moving text between them
+// changes it
+uint64_t Program_cache::source_hash(
+  std::string_view vert_source, std::string_view frag_source
+)
+{
+  std::string sources;
+  sources.reserve(vert_source.size() + frag_source.size() + 1);
+  sources.append(vert_source);
+  sources += '\0';
+  sources.append(frag_source);
+  return Mesh_cache::content_hash(sources);
+}
+
+// Hand a cached binary to the driver, dropping it if rejected
+bool Program_cache::load(GLuint program, uint64_t source_hash) const
+{
+  if (!this->_enabled) {
+    return false;
+  }
+
+  std::string path = this->path(source_hash);
+  std::ifstream infile(path, std::ios::binary);
+  if (!infile.is_open()) {
+    return false;
+  }
+
+  Header header;
+  infile.read(reinterpret_cast<char *>(&header), sizeof(header));
+  if (!infile || std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+      header.version != VERSION || header.driver_hash != this->_driver_hash ||
+      header.source_hash != source_hash) {
+    return false;
+  }
+
+  // A damaged header must not size the allocation, the binary fills the
+  // rest of the file exactly as written by store()
+  std::error_code err;
+  uintmax_t size = std::filesystem::file_size(path, err);
+  if (err || header.length == 0 || size < sizeof(header) ||
+      size - sizeof(header) != header.length) {
+    return false;
+  }
+
+  std::vector<char> binary(header.length);
+  infile.read(binary.data(), binary.size());
+  if (!infile) {
+    return false;
+  }
+
+  Gl_extensions::ProgramBinary(
+    program, header.format, binary.data(), binary.size()
+  );
+  GLint linked = GL_FALSE;
+  glGetProgramiv(program, GL_LINK_STATUS, &linked);
+  if (!linked) {
+    std::remove(path.c_str());
+    return false;
+  }
+  return true;
+}
+
+// Write the binary through a temporary file
+void Program_cache::store(GLuint program, uint64_t source_hash) const
+{
+  if (!this->_enabled) {
+    return;
+  }
+
+  GLint length = 0;
+  glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0) {
+    return;
+  }
+  std::vector<char> binary(length);
+  GLenum format = 0;
+  Gl_extensions::GetProgramBinary(
+    program, length, &length, &format, binary.data()
+  );
+
+  Header header{};
+  std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version = VERSION;
+  header.driver_hash = this->_driver_hash;
+  header.source_hash = source_hash;
+  header.format = format;
+  header.length = length;
+
+  std::string path = this->path(source_hash);
+  static std::atomic<unsigned> counter = 0;
+  std::string tmp_path = path + ".tmp" + std::to_string(getpid()) + "." +
+                         std::to_string(counter++);
+  std::ofstream outfile(tmp_path, std::ios::binary | std::ios::trunc);
+  outfile.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  outfile.write(binary.data(), length);
+  outfile.close();
+  if (!outfile || std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+    std::remove(tmp_path.c_str());
+    std::cerr << "Cannot write file: " << path << '\n';
+  }
+}
+
+// -------- Private Functions -------- //
+std::string Program_cache::path(uint64_t source_hash) const
+{
+  char name[17];
+  std::snprintf(
+    name, sizeof(name), "%016llx", static_cast<unsigned long long>(source_hash)
+  );
+  return this->_dir + "/" + name + ".bin";
+}
@@ -0,0 +1,108 @@
+#include "RangeAllocator.h"
+
+#include <algorithm>
+
+// Constructor
+Range_allocator::Range_allocator(size_t capacity) :
+  _capacity(capacity), _used(0)
+{
+  if (capacity > 0) {
+    this->insert(0, capacity);
+  }
+}
+
+// Best fit, ties go to the lowest offset
+bool Range_allocator::allocate(size_t size, size_t &offset)
+{
+  auto fit = this->_by_size.lower_bound({size, 0});
+  if (size == 0 || fit == this->_by_size.end()) {
+    return false;
+  }
+
+  auto [free_size, free_offset] = *fit;
+  this->erase(this->_free.find(free_offset));
+  if (free_size > size) {
+    this->insert(free_offset + size, free_size - size);
+  }
+
+  offset = free_offset;
+  this->_used += size;
+  return true;
+}
+
+// Merge the range with the free ranges on either side
+void Range_allocator::release(size_t offset, size_t size)
+{
+  if (size == 0) {
+    return;
+  }
+  this->_used -= size;
+
+  auto next = this->_free.lower_bound(offset);
+  if (next != this->_free.end() && offset + size == next->first) {
+    size += next->second;
+    next = std::next(next);
+    this->erase(std::prev(next));
+  }
+  if (next != this->_free.begin()) {
+    auto prev = std::prev(next);
+    if (prev->first + prev->second == offset) {
+      offset = prev->first;
+      size += prev->second;
+      this->erase(prev);
+    }
+  }
+  this->insert(offset, size);
+}
+
+// Add the new space at the end, merging with a free tail
+void Range_allocator::grow(size_t capacity)
+{
+  if (capacity <= this->_capacity) {
+    return;
+  }
+  size_t offset = this->_capacity;
+  size_t extra = capacity - this->_capacity;
+  this->_capacity = capacity;
+  this->_used += extra;
+  this->release(offset, extra);
+}
+
+// Everything after the compacted contents is one free range
+void Range_allocator::reset(size_t used, size_t capacity)
+{
+  this->_free.clear();
+  this->_by_size.clear();
+  this->_capacity = std::max(capacity, used);
+  this->_used = used;
+  if (used < this->_capacity) {
+    this->insert(used, this->_capacity - used);
+  }
+}
+
+size_t Range_allocator::largest_free() const
+{
+  return this->_by_size.empty() ? 0 : this->_by_size.rbegin()->first;
+}
+
+float Range_allocator::fragmentation() const
+{
+  size_t total = this->_capacity - this->_used;
+  if (total == 0) {
+    return 0.0f;
+  }
+  return 1.0f - static_cast<float>(this->largest_free()) / total;
+}
+
+// -------- Private Functions -------- //
+void Range_allocator::insert(size_t offset, size_t size)
+{
+  this->_free.emplace(offset, size);
+  this->_by_size.emplace(size, offset);
+}
+
+void Range_allocator::erase(std::map<size_t, size_t>::iterator range)
+{
+  this->_by_size.erase({range->second, range->first});
+  this->_free.erase(range);
+}
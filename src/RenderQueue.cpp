@@ -0,0 +1,79 @@
+#include "RenderQueue.h"
+
+#include <algorithm>
+#include <array>
+
+namespace {
+  // Keys are sorted a byte at a time
+  constexpr unsigned DIGITS = 8;
+  constexpr size_t RADIX = 256;
+
+  uint64_t field(uint64_t value, unsigned bits)
+  {
+    return value & ((uint64_t(1) << bits) - 1);
+  }
+}  // namespace
+
+// Opaque keys end in the depth, transparent ones start with the reversed
+// depth so farther draws come first
+uint64_t Render_queue::key(
+  Pass pass, uint32_t program, uint32_t mesh, size_t lod, float depth
+)
+{
+  constexpr unsigned STATE_BITS = PROGRAM_BITS + MESH_BITS + LOD_BITS;
+  static_assert(PASS_BITS + STATE_BITS + DEPTH_BITS <= 64);
+
+  uint64_t state = field(program, PROGRAM_BITS) << (MESH_BITS + LOD_BITS) |
+                   field(mesh, MESH_BITS) << LOD_BITS |
+                   std::min<uint64_t>(lod, field(~uint64_t(0), LOD_BITS));
+
+  // Also catches NaN, which fails every comparison
+  depth = depth > 0.0f ? std::min(depth, 1.0f) : 0.0f;
+  uint64_t farthest = field(~uint64_t(0), DEPTH_BITS);
+  uint64_t quantised = static_cast<uint64_t>(depth * farthest);
+
+  uint64_t key = uint64_t(pass) << (64 - PASS_BITS);
+  if (pass == TRANSPARENT) {
+    return key | (farthest - quantised) << STATE_BITS | state;
+  }
+  return key | state << DEPTH_BITS | quantised;
+}
+
+// Least significant digit first, skipping the digits every key shares,
+// which with few meshes and programs is most of them
+void Render_queue::sort()
+{
+  size_t count = this->_items.size();
+  if (count < 2) {
+    return;
+  }
+
+  // Histogram of every digit in one pass over the keys
+  std::array<std::array<uint32_t, RADIX>, DIGITS> counts{};
+  for (const Item &item : this->_items) {
+    for (unsigned digit = 0; digit < DIGITS; ++digit) {
+      ++counts[digit][(item.key >> (8 * digit)) & 0xFF];
+    }
+  }
+
+  this->_scratch.resize(count);
+  for (unsigned digit = 0; digit < DIGITS; ++digit) {
+    std::array<uint32_t, RADIX> &offsets = counts[digit];
+    unsigned shift = 8 * digit;
+    if (offsets[(this->_items[0].key >> shift) & 0xFF] == count) {
+      continue;
+    }
+
+    // Turn the counts into the first slot of each value
+    uint32_t sum = 0;
+    for (uint32_t &offset : offsets) {
+      uint32_t values = offset;
+      offset = sum;
+      sum += values;
+    }
+    for (const Item &item : this->_items) {
+      this->_scratch[offsets[(item.key >> shift) & 0xFF]++] = item;
+    }
+    this->_items.swap(this->_scratch);
+  }
+}
@@ -1,42 +1,95 @@
 #include "Shader.h"
 
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+
+#include "GlExtensions.h"
+
 // Constructor
-Shader::Shader(const std::string &vert_file, const std::string &frag_file)
+Shader::Shader(
+  const std::string &vert_file,
+  const std::string &frag_file,
+  const Program_cache *cache,
+  const std::vector<std::string> &defines,
+  bool wait
+) :
+  _cached(false),
+  _pending(false),
+  _vert_shader(0),
+  _frag_shader(0),
+  _cache(cache),
+  _source_hash(0)
 {
-  // Load code from source files
-  std::string vert_source = Shader::load_shader(vert_file);
-  std::string frag_source = Shader::load_shader(frag_file);
+  // Load code from source files, with the variant's defines
+  std::string vert_source =
+    Shader::define(Shader::load_shader(vert_file), defines);
+  std::string frag_source =
+    Shader::define(Shader::load_shader(frag_file), defines);
   const char *vert_code = vert_source.c_str();
   const char *frag_code = frag_source.c_str();
 
+  // A cached binary skips compiling altogether
+  this->prog_id = glCreateProgram();
+  if (cache && cache->enabled()) {
+    this->_source_hash = Program_cache::source_hash(vert_source, frag_source);
+    if (cache->load(this->prog_id, this->_source_hash)) {
+      this->_cached = true;
+      this->reflect();
+      return;
+    }
+    Gl_extensions::ProgramParameteri(
+      this->prog_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE
+    );
+  }
+
   // Compile Vertex Shader
-  GLuint vert_shader = glCreateShader(GL_VERTEX_SHADER);
-  glShaderSource(vert_shader, 1, &vert_code, nullptr);
-  glCompileShader(vert_shader);
-  check_errors(vert_shader, true);
+  this->_vert_shader = glCreateShader(GL_VERTEX_SHADER);
+  glShaderSource(this->_vert_shader, 1, &vert_code, nullptr);
+  glCompileShader(this->_vert_shader);
 
   // Compile Fragment Shader
-  GLuint frag_shader = glCreateShader(GL_FRAGMENT_SHADER);
-  glShaderSource(frag_shader, 1, &frag_code, nullptr);
-  glCompileShader(frag_shader);
-  check_errors(frag_shader, true);
+  this->_frag_shader = glCreateShader(GL_FRAGMENT_SHADER);
+  glShaderSource(this->_frag_shader, 1, &frag_code, nullptr);
+  glCompileShader(this->_frag_shader);
 
   // Link shaders to program
-  this->prog_id = glCreateProgram();
-  glAttachShader(prog_id, vert_shader);
-  glAttachShader(prog_id, frag_shader);
-  glLinkProgram(prog_id);
-  check_errors(this->prog_id, false);
+  glAttachShader(this->prog_id, this->_vert_shader);
+  glAttachShader(this->prog_id, this->_frag_shader);
+  glLinkProgram(this->prog_id);
 
-  // Delete shaders
-  glDeleteShader(vert_shader);
-  glDeleteShader(frag_shader);
+  // Drivers may keep compiling in the background until the results are read
+  this->_pending = true;
+  if (wait) {
+    this->finish();
+  }
 }
 
 // Destructor
 Shader::~Shader()
 {
-  glDeleteShader(this->prog_id);
+  if (this->_pending) {
+    glDeleteShader(this->_vert_shader);
+    glDeleteShader(this->_frag_shader);
+  }
+  glDeleteProgram(this->prog_id);
+}
+
+// Poll a background compile without stalling on it where possible
+bool Shader::ready()
+{
+  if (!this->_pending) {
+    return true;
+  }
+  if (Gl_extensions::parallel_shader_compile) {
+    GLint done = GL_FALSE;
+    glGetProgramiv(this->prog_id, GL_COMPLETION_STATUS_KHR, &done);
+    if (!done) {
+      return false;
+    }
+  }
+  this->finish();
+  return true;
 }
 
 // Use the shader
@@ -45,46 +98,270 @@ void Shader::use() const
   glUseProgram(this->prog_id);
 }
 
+// Bind a uniform block
+void Shader::bind_block(const std::string &name, GLuint binding)
+{
+  for (const Block_slot &block : this->_blocks) {
+    if (block.name == name) {
+      glUniformBlockBinding(this->prog_id, block.index, binding);
+    }
+  }
+}
+
+// Look up a uniform block's size
+GLint Shader::block_size(const std::string &name) const
+{
+  for (const Block_slot &block : this->_blocks) {
+    if (block.name == name) {
+      return block.size;
+    }
+  }
+  return 0;
+}
+
+// Set an int or sampler
+void Shader::set(Uniform<int> uniform, int value)
+{
+  if (this->changed(uniform.slot, &value, sizeof(value))) {
+    glUniform1i(this->_uniforms[uniform.slot].location, value);
+  }
+}
+
 // Set a float
-void Shader::set_float(const std::string &name, float value)
+void Shader::set(Uniform<float> uniform, float value)
 {
-  glUniform1f(glGetUniformLocation(this->prog_id, name.c_str()), value);
+  if (this->changed(uniform.slot, &value, sizeof(value))) {
+    glUniform1f(this->_uniforms[uniform.slot].location, value);
+  }
 }
 
 // Set a vec3
-void Shader::set_vec3(const std::string &name, glm::vec3 value)
+void Shader::set(Uniform<glm::vec3> uniform, glm::vec3 value)
 {
-  glUniform3f(
-    glGetUniformLocation(this->prog_id, name.c_str()), value.x, value.y, value.z
-  );
+  if (this->changed(uniform.slot, &value, sizeof(value))) {
+    glUniform3fv(
+      this->_uniforms[uniform.slot].location, 1, glm::value_ptr(value)
+    );
+  }
+}
+
+// Set a vec4
+void Shader::set(Uniform<glm::vec4> uniform, glm::vec4 value)
+{
+  if (this->changed(uniform.slot, &value, sizeof(value))) {
+    glUniform4fv(
+      this->_uniforms[uniform.slot].location, 1, glm::value_ptr(value)
+    );
+  }
 }
 
 // Set a mat4
-void Shader::set_mat4(const std::string &name, glm::mat4 value)
+void Shader::set(Uniform<glm::mat4> uniform, const glm::mat4 &value)
 {
-  glUniformMatrix4fv(
-    glGetUniformLocation(this->prog_id, name.c_str()),
-    1,
-    GL_FALSE,
-    glm::value_ptr(value)
-  );
+  if (this->changed(uniform.slot, &value, sizeof(value))) {
+    glUniformMatrix4fv(
+      this->_uniforms[uniform.slot].location,
+      1,
+      GL_FALSE,
+      glm::value_ptr(value)
+    );
+  }
 }
 
 //-------- Private Functions -------- //
-// Load shader file from source
-std::string Shader::load_shader(const std::string &path)
+// Check the results of compiling and linking
+void Shader::finish()
+{
+  this->_pending = false;
+
+  // Release everything on failure, so a failed reload leaks nothing
+  try {
+    check_errors(this->_vert_shader, true);
+    check_errors(this->_frag_shader, true);
+    check_errors(this->prog_id, false);
+  } catch (const std::exception &) {
+    glDeleteShader(this->_vert_shader);
+    glDeleteShader(this->_frag_shader);
+    glDeleteProgram(this->prog_id);
+    this->prog_id = 0;
+    throw;
+  }
+
+  // Delete shaders
+  glDeleteShader(this->_vert_shader);
+  glDeleteShader(this->_frag_shader);
+
+  if (this->_cache && this->_cache->enabled()) {
+    this->_cache->store(this->prog_id, this->_source_hash);
+  }
+  this->reflect();
+}
+
+// Load shader file from source, pasting in included files
+std::string Shader::load_shader(const std::string &path, int depth)
 {
+  if (depth > MAX_INCLUDE_DEPTH) {
+    throw std::runtime_error("Shader includes nested too deep: " + path);
+  }
+
   std::ifstream infile(path);
   if (!infile.is_open()) {
     throw std::runtime_error("Cannot open file: " + path);
   }
+
+  // Includes are relative to the including file
+  std::string dir = std::filesystem::path(path).parent_path().string();
+  if (!dir.empty()) {
+    dir += '/';
+  }
+
   std::stringstream ss;
-  ss << infile.rdbuf();
+  std::string line;
+  int number = 0;
+  while (std::getline(infile, line)) {
+    ++number;
+    size_t start = line.find_first_not_of(" \t");
+    if (start == std::string::npos ||
+        line.compare(start, 8, "#include") != 0) {
+      ss << line << '\n';
+      continue;
+    }
+
+    size_t open = line.find('"', start + 8);
+    size_t close =
+      open == std::string::npos ? open : line.find('"', open + 1);
+    if (close == std::string::npos) {
+      throw std::runtime_error(
+        "Malformed include in " + path + ":" + std::to_string(number)
+      );
+    }
+
+    // Keep compiler messages pointing at the right lines
+    std::string include = line.substr(open + 1, close - open - 1);
+    ss << "#line 1\n"
+       << Shader::load_shader(dir + include, depth + 1) << "#line "
+       << number + 1 << '\n';
+  }
 
   infile.close();
   return ss.str();
 }
 
+// Define feature macros right after the version directive
+std::string Shader::define(
+  const std::string &source, const std::vector<std::string> &defines
+)
+{
+  if (defines.empty()) {
+    return source;
+  }
+
+  std::string block;
+  for (const std::string &name : defines) {
+    block += "#define " + name + '\n';
+  }
+
+  // The version must stay the first directive
+  size_t start = 0;
+  int line = 1;
+  if (source.starts_with("#version")) {
+    start = source.find('\n');
+    start = start == std::string::npos ? source.size() : start + 1;
+    line = 2;
+  }
+  return source.substr(0, start) + block + "#line " + std::to_string(line) +
+         '\n' + source.substr(start);
+}
+
+// List active uniforms and blocks once after linking
+void Shader::reflect()
+{
+  GLint count = 0;
+  GLint length = 0;
+  glGetProgramiv(this->prog_id, GL_ACTIVE_UNIFORMS, &count);
+  glGetProgramiv(this->prog_id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &length);
+  std::vector<char> name(std::max(length, 1));
+
+  for (GLint i = 0; i < count; ++i) {
+    GLint size;
+    GLenum type;
+    glGetActiveUniform(
+      this->prog_id, i, name.size(), nullptr, &size, &type, name.data()
+    );
+
+    // Uniforms inside blocks have no location
+    GLint location = glGetUniformLocation(this->prog_id, name.data());
+    if (location < 0) {
+      continue;
+    }
+
+    // Arrays are listed as their first element
+    std::string uniform = name.data();
+    if (uniform.ends_with("[0]")) {
+      uniform.resize(uniform.size() - 3);
+    }
+    this->_uniforms.push_back({uniform, location, type, false, {}});
+  }
+
+  glGetProgramiv(this->prog_id, GL_ACTIVE_UNIFORM_BLOCKS, &count);
+  glGetProgramiv(
+    this->prog_id, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &length
+  );
+  name.resize(std::max(length, 1));
+
+  for (GLint i = 0; i < count; ++i) {
+    GLint size;
+    glGetActiveUniformBlockName(
+      this->prog_id, i, name.size(), nullptr, name.data()
+    );
+    glGetActiveUniformBlockiv(
+      this->prog_id, i, GL_UNIFORM_BLOCK_DATA_SIZE, &size
+    );
+    this->_blocks.push_back({name.data(), GLuint(i), size});
+  }
+
+  // Every program shares the camera data written once per frame
+  this->bind_block("Camera", Shader::CAMERA_BLOCK);
+}
+
+// Find a uniform, samplers are set as ints
+int Shader::find(const std::string &name, GLenum type) const
+{
+  for (size_t i = 0; i < this->_uniforms.size(); ++i) {
+    const Uniform_slot &slot = this->_uniforms[i];
+    if (slot.name != name) {
+      continue;
+    }
+
+    bool sampler =
+      slot.type == GL_SAMPLER_2D || slot.type == GL_SAMPLER_3D ||
+      slot.type == GL_SAMPLER_CUBE || slot.type == GL_SAMPLER_2D_ARRAY ||
+      slot.type == GL_SAMPLER_2D_SHADOW;
+    if (slot.type == type || (type == GL_INT && sampler)) {
+      return i;
+    }
+    std::cerr << "Uniform " << name << " set with the wrong type\n";
+    return -1;
+  }
+  return -1;
+}
+
+// Compare with the cached value
+bool Shader::changed(int slot, const void *value, size_t bytes)
+{
+  if (slot < 0) {
+    return false;
+  }
+
+  Uniform_slot &uniform = this->_uniforms[slot];
+  if (uniform.set && std::memcmp(uniform.value, value, bytes) == 0) {
+    return false;
+  }
+  std::memcpy(uniform.value, value, bytes);
+  uniform.set = true;
+  return true;
+}
+
 // Check for compiltion errors in shader and linker
 void Shader::check_errors(GLuint object, bool shader)
 {
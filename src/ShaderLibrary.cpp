@@ -0,0 +1,131 @@
+#include "ShaderLibrary.h"
+
+#include <iostream>
+
+// Constructor
+Shader_library::Shader_library(
+  const std::string &vert_file,
+  const std::string &frag_file,
+  const Program_cache *cache,
+  Setup setup,
+  uint32_t fallback_features
+) :
+  _vert_file(vert_file),
+  _frag_file(frag_file),
+  _cache(cache),
+  _setup(setup),
+  _fallback_features(fallback_features)
+{
+  this->_fallback = this->build(fallback_features, true);
+  this->_setup(*(this->_fallback));
+}
+
+// Look up or start a variant, drawing with the fallback meanwhile
+Shader &Shader_library::get(uint32_t features)
+{
+  if (features == this->_fallback_features) {
+    return *(this->_fallback);
+  }
+
+  auto it = this->_variants.find(features);
+  if (it == this->_variants.end()) {
+    Variant variant{nullptr, false};
+    try {
+      variant.shader = this->build(features, false);
+    } catch (const std::exception &err) {
+      std::cerr << err.what() << "\n";
+    }
+    it = this->_variants.emplace(features, std::move(variant)).first;
+  }
+
+  Variant &variant = it->second;
+  if (!variant.shader) {
+    return *(this->_fallback);
+  }
+  try {
+    if (!variant.shader->ready()) {
+      return *(this->_fallback);
+    }
+    if (!variant.setup) {
+      this->_setup(*(variant.shader));
+      variant.setup = true;
+    }
+  } catch (const std::exception &err) {
+    std::cerr << err.what() << "\nDrawing shader variant " << features
+              << " with the fallback\n";
+    variant.shader.reset();
+    return *(this->_fallback);
+  }
+  return *(variant.shader);
+}
+
+// Compile the new fallback without holding up the frame, replacing any
+// earlier reload still in progress
+void Shader_library::reload()
+{
+  this->_next_fallback = this->build(this->_fallback_features, false);
+}
+
+// Swap in the new fallback only once it has built
+bool Shader_library::finish_reload()
+{
+  if (!this->_next_fallback) {
+    return false;
+  }
+  try {
+    if (!this->_next_fallback->ready()) {
+      return false;
+    }
+    this->_setup(*(this->_next_fallback));
+  } catch (const std::exception &) {
+    this->_next_fallback.reset();
+    throw;
+  }
+
+  this->_fallback = std::move(this->_next_fallback);
+  this->_variants.clear();
+  return true;
+}
+
+size_t Shader_library::pending() const
+{
+  size_t count = 0;
+  for (const auto &[features, variant] : this->_variants) {
+    if (variant.shader && !variant.setup) {
+      ++count;
+    }
+  }
+  return count;
+}
+
+// -------- Private Functions -------- //
+std::unique_ptr<Shader>
+Shader_library::build(uint32_t features, bool wait) const
+{
+  return std::make_unique<Shader>(
+    this->_vert_file,
+    this->_frag_file,
+    this->_cache,
+    Shader_library::defines(features),
+    wait
+  );
+}
+
+// -------- Static Functions -------- //
+std::vector<std::string> Shader_library::defines(uint32_t features)
+{
+  std::vector<std::string> names;
+  if (features & QUANTIZED) {
+    names.push_back("QUANTIZED");
+  }
+  if (features & LIGHTING) {
+    names.push_back("LIGHTING");
+  }
+  if (features & NORMALS) {
+    names.push_back("NORMALS");
+  }
+  if (features & MULTI_DRAW) {
+    names.push_back("MULTI_DRAW");
+  }
+  return names;
+}
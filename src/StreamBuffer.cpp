@@ -0,0 +1,169 @@
+#include "StreamBuffer.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "GlExtensions.h"
+#include "GpuMemory.h"
+
+// Constructor
+Stream_buffer::Stream_buffer(GLenum target, size_t frame_bytes) :
+  _target(target),
+  _buffer(0),
+  _alignment(1),
+  _frame_bytes(0),
+  _mapped(nullptr),
+  _frame(0),
+  _head(0),
+  _fences{nullptr, nullptr, nullptr}
+{
+  // Offsets bound to uniform and storage blocks have to be aligned,
+  // indirect commands must start on 4 bytes and vertex attributes are read
+  // fastest from 4-byte aligned offsets
+  if (target == GL_UNIFORM_BUFFER || target == GL_SHADER_STORAGE_BUFFER) {
+    GLint alignment = 1;
+    glGetIntegerv(
+      target == GL_UNIFORM_BUFFER ? GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+                                  : GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT,
+      &alignment
+    );
+    this->_alignment = std::max(1, alignment);
+  }
+  else if (target == GL_ARRAY_BUFFER || target == GL_DRAW_INDIRECT_BUFFER) {
+    this->_alignment = 4;
+  }
+  this->create(frame_bytes);
+}
+
+// Destructor
+Stream_buffer::~Stream_buffer()
+{
+  this->destroy();
+}
+
+// Move to the next region once the GPU has finished with it
+void Stream_buffer::begin_frame(size_t bytes)
+{
+  if (bytes > this->_frame_bytes) {
+    this->destroy();
+    this->create(std::max(bytes, 2 * this->_frame_bytes));
+  }
+
+  if (this->persistent()) {
+    this->_frame = (this->_frame + 1) % FRAMES;
+    Stream_buffer::wait(this->_fences[this->_frame]);
+  }
+  this->_head = 0;
+}
+
+size_t Stream_buffer::aligned(size_t bytes) const
+{
+  return (bytes + this->_alignment - 1) / this->_alignment * this->_alignment;
+}
+
+// Append data to the frame's region
+size_t Stream_buffer::write(const void *data, size_t bytes)
+{
+  size_t offset = this->_head;
+  this->_head += this->aligned(bytes);
+
+  if (this->persistent()) {
+    offset += this->_frame * this->_frame_bytes;
+    std::memcpy(this->_mapped + offset, data, bytes);
+  }
+  else {
+    std::memcpy(this->_staging.data() + offset, data, bytes);
+  }
+  return offset;
+}
+
+// Coherent mappings need no flush, orphaning uploads the whole frame
+void Stream_buffer::flush()
+{
+  if (this->persistent() || this->_head == 0) {
+    return;
+  }
+  glBindBuffer(this->_target, this->_buffer);
+  glBufferData(this->_target, this->_frame_bytes, nullptr, GL_STREAM_DRAW);
+  glBufferSubData(this->_target, 0, this->_head, this->_staging.data());
+}
+
+void Stream_buffer::bind(GLuint index, size_t offset, size_t bytes) const
+{
+  glBindBufferRange(this->_target, index, this->_buffer, offset, bytes);
+}
+
+// Fence the region so it is not rewritten while still in use
+void Stream_buffer::end_frame()
+{
+  if (this->persistent()) {
+    this->_fences[this->_frame] =
+      glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  }
+}
+
+// -------- Private Functions -------- //
+void Stream_buffer::create(size_t frame_bytes)
+{
+  this->_frame_bytes = this->aligned(std::max<size_t>(frame_bytes, 1));
+  this->_frame = 0;
+  glGenBuffers(1, &(this->_buffer));
+  glBindBuffer(this->_target, this->_buffer);
+
+  // Map every region once and keep it mapped
+  if (Gl_extensions::buffer_storage) {
+    size_t size = FRAMES * this->_frame_bytes;
+    GLbitfield flags =
+      GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    Gl_extensions::BufferStorage(this->_target, size, nullptr, flags);
+    this->_mapped = static_cast<std::byte *>(
+      glMapBufferRange(this->_target, 0, size, flags)
+    );
+    if (this->_mapped) {
+      Gpu_memory::shared().allocate(Gpu_memory::DYNAMIC, size);
+      return;
+    }
+
+    // Immutable storage cannot be respecified for orphaning
+    glDeleteBuffers(1, &(this->_buffer));
+    glGenBuffers(1, &(this->_buffer));
+    glBindBuffer(this->_target, this->_buffer);
+  }
+
+  glBufferData(this->_target, this->_frame_bytes, nullptr, GL_STREAM_DRAW);
+  this->_staging.resize(this->_frame_bytes);
+  Gpu_memory::shared().allocate(Gpu_memory::DYNAMIC, this->_frame_bytes);
+}
+
+void Stream_buffer::destroy()
+{
+  for (GLsync &fence : this->_fences) {
+    Stream_buffer::wait(fence);
+  }
+
+  // Orphaned buffers only hold one region at a time
+  Gpu_memory::shared().release(
+    Gpu_memory::DYNAMIC,
+    this->_mapped ? FRAMES * this->_frame_bytes : this->_frame_bytes
+  );
+  if (this->_mapped) {
+    glBindBuffer(this->_target, this->_buffer);
+    glUnmapBuffer(this->_target);
+    this->_mapped = nullptr;
+  }
+  glDeleteBuffers(1, &(this->_buffer));
+  this->_buffer = 0;
+}
+
+// -------- Static Functions -------- //
+void Stream_buffer::wait(GLsync &fence)
+{
+  if (!fence) {
+    return;
+  }
+  while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) ==
+         GL_TIMEOUT_EXPIRED) {
+  }
+  glDeleteSync(fence);
+  fence = nullptr;
+}
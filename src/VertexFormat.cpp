@@ -0,0 +1,71 @@
+#include "VertexFormat.h"
+
+#include <algorithm>
+#include <cstdint>
+
+const Vertex_attribute *Vertex_format::find(GLuint location) const
+{
+  for (size_t i = 0; i < this->attribute_count; ++i) {
+    if (this->attributes[i].location == location) {
+      return &(this->attributes[i]);
+    }
+  }
+  return nullptr;
+}
+
+bool Vertex_format::same_layout(const Vertex_format &other) const
+{
+  return this->stride == other.stride &&
+         this->attribute_count == other.attribute_count &&
+         std::equal(
+           this->attributes.begin(),
+           this->attributes.begin() + this->attribute_count,
+           other.attributes.begin()
+         );
+}
+
+// Vertex arrays start with every location disabled, but one may be
+// repointed at a buffer of another layout
+void Vertex_format::apply() const
+{
+  for (GLuint location : {POSITION, NORMAL, TEXCOORD, COLOUR}) {
+    const Vertex_attribute *attribute = this->find(location);
+    if (!attribute) {
+      glDisableVertexAttribArray(location);
+      continue;
+    }
+    glVertexAttribPointer(
+      location,
+      attribute->components,
+      attribute->type,
+      attribute->normalized,
+      this->stride,
+      reinterpret_cast<const void *>(
+        static_cast<uintptr_t>(attribute->offset)
+      )
+    );
+    glEnableVertexAttribArray(location);
+  }
+}
+
+// Vertex arrays are shared by every mesh of a layout, so the attributes are
+// repointed for each range
+void Instance_range::apply() const
+{
+  glBindBuffer(GL_ARRAY_BUFFER, this->buffer);
+  for (GLuint column = 0; column < 5; ++column) {
+    // The colour follows the four model matrix columns
+    GLuint location = column < 4 ? INSTANCE_MODEL + column : INSTANCE_COLOUR;
+    size_t start = this->offset + column * sizeof(glm::vec4);
+    glVertexAttribPointer(
+      location,
+      4,
+      GL_FLOAT,
+      GL_FALSE,
+      sizeof(Instance),
+      reinterpret_cast<const void *>(static_cast<uintptr_t>(start))
+    );
+    glVertexAttribDivisor(location, 1);
+    glEnableVertexAttribArray(location);
+  }
+}
@@ -0,0 +1,315 @@
+#include "WavefrontImporter.h"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+
+#include "MeshCache.h"
+
+namespace {
+  bool is_space(char c)
+  {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+  }
+
+  void skip_space(const char *&cur, const char *end)
+  {
+    while (cur < end && is_space(*cur)) {
+      ++cur;
+    }
+  }
+
+  // Parse a number, accepting an explicit plus sign
+  template <typename T>
+  bool parse_number(const char *&cur, const char *end, T &value)
+  {
+    if (cur < end && *cur == '+') {
+      ++cur;
+    }
+    auto [ptr, err] = std::from_chars(cur, end, value);
+    if (err != std::errc() || ptr == cur) {
+      return false;
+    }
+    cur = ptr;
+    return true;
+  }
+}  // namespace
+
+// Constructor
+Wavefront_importer::Wavefront_importer(
+  const std::string &filepath, size_t chunk_size
+) :
+  _counts{0, 0, 0}, _used{false, false, false}, _path(filepath),
+  source_hash(0)
+{
+  auto start = std::chrono::steady_clock::now();
+
+  std::ifstream infile(filepath, std::ios::binary);
+  if (!infile.is_open()) {
+    throw std::runtime_error("Cannot open file: " + filepath);
+  }
+
+  // Number of chunks parsed in parallel before merging
+  size_t batch = std::max(1u, std::thread::hardware_concurrency());
+
+  size_t total = 0;
+  Mesh_cache::Hasher hasher;
+  std::string carry;
+  bool eof = false;
+  while (!eof) {
+    // Read a batch of chunks, each ending on a line break
+    std::vector<std::string> texts;
+    while (texts.size() < batch && !eof) {
+      std::string text = std::move(carry);
+      carry.clear();
+
+      size_t used = text.size();
+      text.resize(used + chunk_size);
+      infile.read(text.data() + used, chunk_size);
+      size_t got = static_cast<size_t>(infile.gcount());
+      text.resize(used + got);
+      hasher.update(std::string_view(text).substr(used));
+      total += got;
+      eof = got < chunk_size;
+
+      // Hold back the partial last line for the next chunk
+      if (!eof) {
+        size_t split = text.rfind('\n');
+        if (split == std::string::npos) {
+          carry = std::move(text);
+          continue;
+        }
+        carry = text.substr(split + 1);
+        text.resize(split + 1);
+      }
+      texts.push_back(std::move(text));
+    }
+
+    // Parse the batch in parallel and merge in file order
+    std::vector<std::future<Chunk>> chunks;
+    for (const std::string &text : texts) {
+      chunks.push_back(std::async(std::launch::async, [this, &text] {
+        return this->parse(text);
+      }));
+    }
+    for (std::future<Chunk> &chunk : chunks) {
+      this->merge(chunk.get());
+    }
+  }
+
+  this->source_hash = hasher.digest();
+
+  // Attributes no face referred to are dropped
+  if (!this->_used[1]) {
+    this->uvs.clear();
+  }
+  if (!this->_used[2]) {
+    this->normals.clear();
+  }
+
+  // Report parsing throughput
+  std::chrono::duration<double> elapsed =
+    std::chrono::steady_clock::now() - start;
+  double mbps = total / (1024.0 * 1024.0) / elapsed.count();
+  std::cout << "Reading file " << filepath << " (" << total << " bytes, "
+            << mbps << " MB/s)\n";
+}
+
+// Check the file extension
+bool Wavefront_importer::handles(const std::string &filepath)
+{
+  return filepath.size() > 4 &&
+         filepath.compare(filepath.size() - 4, 4, ".obj") == 0;
+}
+
+// -------- Private Functions -------- //
+// Parse the statements of a chunk, leaving indices unresolved
+Wavefront_importer::Chunk Wavefront_importer::parse(std::string_view text) const
+{
+  Chunk chunk;
+  const char *cur = text.data();
+  const char *end = text.data() + text.size();
+
+  while (cur < end) {
+    const char *eol = std::find(cur, end, '\n');
+    skip_space(cur, eol);
+
+    // Statement keyword
+    const char *word = cur;
+    while (cur < eol && !is_space(*cur)) {
+      ++cur;
+    }
+    std::string_view keyword(word, cur - word);
+
+    // Vertex position, any extra components are ignored
+    if (keyword == "v") {
+      this->read_floats(cur, eol, 3, 3, chunk.positions);
+      ++chunk.counts[0];
+    }
+    // Texture co-ordinates, v defaults to 0 and w is ignored
+    else if (keyword == "vt") {
+      this->read_floats(cur, eol, 2, 1, chunk.texcoords);
+      ++chunk.counts[1];
+    }
+    else if (keyword == "vn") {
+      this->read_floats(cur, eol, 3, 3, chunk.normals);
+      ++chunk.counts[2];
+    }
+    // Polygon made of v, v/vt, v//vn or v/vt/vn corners
+    else if (keyword == "f") {
+      uint32_t size = 0;
+      skip_space(cur, eol);
+      while (cur < eol) {
+        Corner corner{{-1, -1, -1}, 0};
+        for (int k = 0; k < 3; ++k) {
+          int64_t value;
+          if (cur < eol && *cur != '/' && !is_space(*cur)) {
+            if (!parse_number(cur, eol, value) || value == 0) {
+              throw std::runtime_error(
+                "Malformed face in file: " + this->_path
+              );
+            }
+            // Negative indices count back from the latest declaration
+            if (value < 0) {
+              corner.index[k] = chunk.counts[k] + value;
+              corner.relative |= 1 << k;
+            }
+            else {
+              corner.index[k] = value - 1;
+            }
+          }
+          if (cur < eol && *cur == '/') {
+            ++cur;
+          }
+          else {
+            break;
+          }
+        }
+        chunk.corners.push_back(corner);
+        ++size;
+        skip_space(cur, eol);
+      }
+      if (size < 3) {
+        throw std::runtime_error("Degenerate face in file: " + this->_path);
+      }
+      chunk.face_sizes.push_back(size);
+    }
+
+    cur = eol < end ? eol + 1 : end;
+  }
+
+  return chunk;
+}
+
+// Resolve a chunk's indices and append its triangles
+void Wavefront_importer::merge(const Chunk &chunk)
+{
+  int64_t base[3] = {this->_counts[0], this->_counts[1], this->_counts[2]};
+  for (int k = 0; k < 3; ++k) {
+    this->_counts[k] += chunk.counts[k];
+  }
+  this->_positions.insert(
+    this->_positions.end(), chunk.positions.begin(), chunk.positions.end()
+  );
+  this->_texcoords.insert(
+    this->_texcoords.end(), chunk.texcoords.begin(), chunk.texcoords.end()
+  );
+  this->_normals.insert(
+    this->_normals.end(), chunk.normals.begin(), chunk.normals.end()
+  );
+
+  std::vector<unsigned int> polygon;
+  size_t next = 0;
+  for (uint32_t size : chunk.face_sizes) {
+    // Map each corner to a unique output vertex
+    polygon.clear();
+    for (uint32_t i = 0; i < size; ++i) {
+      const Corner &corner = chunk.corners[next++];
+      std::array<int64_t, 3> key;
+      for (int k = 0; k < 3; ++k) {
+        bool relative = corner.relative & (1 << k);
+        key[k] = corner.index[k] + (relative ? base[k] : 0);
+
+        // Only texture and normal indices may be left out
+        bool absent = !relative && corner.index[k] < 0;
+        bool in_range = key[k] >= 0 && key[k] < this->_counts[k];
+        if (absent ? k == 0 : !in_range) {
+          throw std::runtime_error(
+            "Invalid face index in file: " + this->_path
+          );
+        }
+        this->_used[k] |= !absent;
+      }
+
+      auto [it, inserted] =
+        this->_tuples.try_emplace(key, this->vertices.size() / 3);
+      if (inserted) {
+        const float *pos = &this->_positions[3 * key[0]];
+        this->vertices.insert(this->vertices.end(), pos, pos + 3);
+        if (key[1] >= 0) {
+          const float *uv = &this->_texcoords[2 * key[1]];
+          this->uvs.insert(this->uvs.end(), uv, uv + 2);
+        }
+        else {
+          this->uvs.insert(this->uvs.end(), {0.0f, 0.0f});
+        }
+        if (key[2] >= 0) {
+          const float *normal = &this->_normals[3 * key[2]];
+          this->normals.insert(this->normals.end(), normal, normal + 3);
+        }
+        else {
+          this->normals.insert(this->normals.end(), {0.0f, 0.0f, 0.0f});
+        }
+      }
+      polygon.push_back(it->second);
+    }
+
+    // Fan triangulation, polygons are assumed to be convex
+    for (uint32_t i = 1; i + 1 < size; ++i) {
+      this->indices.insert(
+        this->indices.end(), {polygon[0], polygon[i], polygon[i + 1]}
+      );
+    }
+  }
+}
+
+// Read a fixed number of floats, leaving the rest of the line
+void Wavefront_importer::read_floats(
+  const char *&cur,
+  const char *end,
+  int count,
+  int required,
+  std::vector<float> &out
+) const
+{
+  for (int i = 0; i < count; ++i) {
+    float value = 0.0f;
+    skip_space(cur, end);
+    if (i >= required && cur == end) {
+      out.push_back(value);
+      continue;
+    }
+    if (!parse_number(cur, end, value)) {
+      throw std::runtime_error("Malformed vertex in file: " + this->_path);
+    }
+    out.push_back(value);
+  }
+}
+
+// Mix the three indices of a corner
+size_t Wavefront_importer::Key_hash::operator()(
+  const std::array<int64_t, 3> &key
+) const
+{
+  uint64_t hash = static_cast<uint64_t>(key[0]) * 0x9e3779b97f4a7c15ULL;
+  hash ^= static_cast<uint64_t>(key[1]) + 0x7f4a7c159e3779b9ULL + (hash << 6) +
+          (hash >> 2);
+  hash ^= static_cast<uint64_t>(key[2]) + 0x94d049bb133111ebULL + (hash << 6) +
+          (hash >> 2);
+  return hash;
+}
@@ -0,0 +1,9 @@
+// Shared by every program, bound to Shader::CAMERA_BLOCK
+layout (std140) uniform Camera
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 cameraPosition;
+    vec4 frustum[6];
+};
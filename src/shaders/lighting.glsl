@@ -0,0 +1,9 @@
+// Directional light in world space
+const vec3 lightDirection = normalize(vec3(0.4, 1.0, 0.6));
+const float ambient = 0.3;
+
+vec3 shade(vec3 albedo, vec3 normal)
+{
+    float diffuse = max(dot(normal, lightDirection), 0.0);
+    return albedo * (ambient + (1.0 - ambient) * diffuse);
+}
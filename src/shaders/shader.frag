@@ -1,9 +1,30 @@
 #version 330 core
 out vec4 fragColour;
 
-uniform vec3 objColour;
+// Alpha is only blended for transparent objects
+in vec4 colour;
+#ifdef LIGHTING
+in vec3 worldPos;
+#ifdef NORMALS
+in vec3 worldNormal;
+#endif
+
+#include "lighting.glsl"
+#endif
 
 void main()
 {
-    fragColour = vec4(objColour, 1.0f);
+#ifdef LIGHTING
+    // Face normal from screen space derivatives, unless the mesh has normals
+    vec3 normal = normalize(cross(dFdx(worldPos), dFdy(worldPos)));
+#ifdef NORMALS
+    // Vertices the file gave no normal carry a zero one
+    if (dot(worldNormal, worldNormal) > 1e-8) {
+        normal = normalize(worldNormal);
+    }
+#endif
+    fragColour = vec4(shade(colour.rgb, normal), colour.a);
+#else
+    fragColour = colour;
+#endif
 }
@@ -1,11 +1,69 @@
 #version 330 core
+#ifdef MULTI_DRAW
+#extension GL_ARB_shader_draw_parameters : require
+#extension GL_ARB_shader_storage_buffer_object : require
+#extension GL_ARB_shading_language_420pack : require
+#endif
 layout (location = 0) in vec3 aPos;
+#ifdef NORMALS
+layout (location = 1) in vec3 aNormal;
+#endif
+// White unless the mesh has vertex colours
+layout (location = 3) in vec4 aColour;
 
-uniform mat4 projection;
-uniform mat4 view;
-uniform mat4 model;
+// Per-instance attributes, the matrix takes locations 4 to 7
+layout (location = 4) in mat4 aModel;
+layout (location = 8) in vec4 aInstanceColour;
+
+#include "camera.glsl"
+
+#ifdef MULTI_DRAW
+// Values of every mesh in a multi-draw call, one per draw
+struct Mesh_values
+{
+    vec4 posScale;
+    vec4 posOffset;
+};
+
+layout (std430, binding = 2) readonly buffer Meshes
+{
+    Mesh_values meshes[];
+};
+#else
+layout (std140) uniform Mesh
+{
+    // Maps quantised positions back to mesh space
+    vec4 posScale;
+    vec4 posOffset;
+};
+#endif
+
+out vec4 colour;
+#ifdef LIGHTING
+out vec3 worldPos;
+#ifdef NORMALS
+out vec3 worldNormal;
+#endif
+#endif
 
 void main()
 {
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
+#if defined(QUANTIZED) && defined(MULTI_DRAW)
+    Mesh_values mesh = meshes[gl_DrawIDARB];
+    vec3 pos = aPos * mesh.posScale.xyz + mesh.posOffset.xyz;
+#elif defined(QUANTIZED)
+    vec3 pos = aPos * posScale.xyz + posOffset.xyz;
+#else
+    vec3 pos = aPos;
+#endif
+    vec4 world = aModel * vec4(pos, 1.0);
+    gl_Position = viewProjection * world;
+    colour = aInstanceColour * aColour;
+#ifdef LIGHTING
+    worldPos = world.xyz;
+#ifdef NORMALS
+    // Exact for rotation and uniform scale, close for mild non-uniform scale
+    worldNormal = mat3(aModel) * aNormal;
+#endif
+#endif
 }